@@ -0,0 +1,119 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	Times decoding, looking up every element of, and encoding a header-sized
+	data set, held as a DataSet (a std::multimap) and as a FlatDataSet (a
+	sorted vector).  Lookups go in a scrambled order, so that they aren't
+	just walking the container.
+
+	Usage: FlatDataSetBench [elements] [iterations]
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include "dicomlib.hpp"
+#include "Buffer.hpp"
+#include "Encoder.hpp"
+#include "Decoder.hpp"
+
+using namespace dicom;
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double Microseconds(Clock::time_point begin,Clock::time_point end,size_t count)
+	{
+		return std::chrono::duration<double,std::micro>(end-begin).count()/count;
+	}
+
+	//!Alternating US and LO elements, spread over a few groups.
+	DataSet MakeHeader(size_t elements,vector<Tag>& tags)
+	{
+		DataSet data;
+		for(size_t i=0;i<elements;i++)
+		{
+			Tag tag=makeTag(UINT16(0x0008+8*(i/40)),UINT16(0x1000+2*(i%40)));
+			tags.push_back(tag);
+			if(i%2)
+				data.Put<VR_LO>(tag,std::string("value"));
+			else
+				data.Put<VR_US>(tag,UINT16(i));
+		}
+		for(size_t i=0;i<tags.size();i++)
+			std::swap(tags[i],tags[(i*7919)%tags.size()]);
+		return data;
+	}
+
+	template<typename DATA_SET>
+	void Run(const char* name,const vector<BYTE>& encoded,TS ts,const vector<Tag>& tags,size_t iterations)
+	{
+		size_t checksum=0;
+
+		Clock::time_point start=Clock::now();
+		for(size_t i=0;i<iterations;i++)
+		{
+			ByteCursor cursor(&encoded[0],&encoded[0]+encoded.size(),__LITTLE_ENDIAN);
+			DATA_SET data;
+			ReadFromBuffer(cursor,data,ts);
+			checksum+=data.size();
+		}
+		Clock::time_point decoded=Clock::now();
+
+		DATA_SET data;
+		ByteCursor cursor(&encoded[0],&encoded[0]+encoded.size(),__LITTLE_ENDIAN);
+		ReadFromBuffer(cursor,data,ts);
+
+		const size_t rounds=200;
+		Clock::time_point lookups=Clock::now();
+		for(size_t r=0;r<rounds;r++)
+			for(vector<Tag>::const_iterator I=tags.begin();I!=tags.end();++I)
+				checksum+=data(*I).vr();
+		Clock::time_point looked_up=Clock::now();
+
+		for(size_t i=0;i<iterations;i++)
+		{
+			Buffer buffer(__LITTLE_ENDIAN);
+			WriteToBuffer(data,buffer,ts);
+			checksum+=buffer.size();
+		}
+		Clock::time_point encoded_all=Clock::now();
+
+		cout << name
+			<< "  decode " << Microseconds(start,decoded,iterations) << " us"
+			<< ", lookup " << 1000*Microseconds(lookups,looked_up,rounds*tags.size()) << " ns"
+			<< ", encode " << Microseconds(looked_up,encoded_all,iterations) << " us"
+			<< "  (" << checksum%10 << ")" << endl;
+	}
+}
+
+int main(int argc,char* argv[])
+{
+	size_t elements=argc>1 ? atoi(argv[1]) : 320;
+	size_t iterations=argc>2 ? atoi(argv[2]) : 5000;
+
+	vector<Tag> tags;
+	DataSet header=MakeHeader(elements,tags);
+	TS ts(EXPL_VR_LE_TRANSFER_SYNTAX);
+	Buffer buffer(__LITTLE_ENDIAN);
+	WriteToBuffer(header,buffer,ts);
+	vector<BYTE> encoded(buffer.begin(),buffer.end());
+
+	cout << header.size() << " elements, " << encoded.size() << " bytes, explicit VR little endian" << endl;
+	for(int run=0;run<3;run++)
+	{
+		Run<DataSet>("DataSet    ",encoded,ts,tags,iterations);
+		Run<FlatDataSet>("FlatDataSet",encoded,ts,tags,iterations);
+	}
+	return 0;
+}
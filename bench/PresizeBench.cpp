@@ -0,0 +1,77 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	Times WriteToBuffer() as it is, letting the Buffer grow as it goes,
+	against reserving EncodedLength() bytes first.  This is why
+	WriteToBuffer() doesn't size the buffer up front: the extra walk over
+	the data set costs more than the reallocations it saves.
+
+	Usage: PresizeBench [header elements]
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include "dicomlib.hpp"
+#include "Buffer.hpp"
+#include "Encoder.hpp"
+
+using namespace dicom;
+using std::cout;
+using std::endl;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	//!Best of 20 runs of 50 calls, in microseconds per call.
+	template<typename F>
+	double Best(F f)
+	{
+		double best=1e9;
+		for(int run=0;run<20;run++)
+		{
+			Clock::time_point start=Clock::now();
+			for(int i=0;i<50;i++)
+				f();
+			best=std::min(best,std::chrono::duration<double,std::micro>(Clock::now()-start).count()/50);
+		}
+		return best;
+	}
+
+	void Run(const char* name,const DataSet& data,TS transfer_syntax)
+	{
+		double growing=Best([&]{
+			Buffer buffer(__LITTLE_ENDIAN);
+			WriteToBuffer(data,buffer,transfer_syntax);
+		});
+		double presized=Best([&]{
+			Buffer buffer(__LITTLE_ENDIAN);
+			buffer.reserve(EncodedLength(data,transfer_syntax));
+			WriteToBuffer(data,buffer,transfer_syntax);
+		});
+		cout << name << "  growing " << growing << " us, presized " << presized << " us" << endl;
+	}
+}
+
+int main(int argc,char* argv[])
+{
+	int elements=argc>1 ? atoi(argv[1]) : 200;
+	TS transfer_syntax(EXPL_VR_LE_TRANSFER_SYNTAX);
+
+	DataSet header;
+	for(int i=0;i<elements;i++)
+		header.Put<VR_SH>(makeTag(0x0011,0x1000+i),std::string(i%13+1,'x'));
+	Run("header",header,transfer_syntax);
+
+	DataSet image(header);
+	image.Put<VR_OW>(TAG_PIXEL_DATA,std::vector<UINT16>(512*512,3));
+	Run("header + 512x512 OW",image,transfer_syntax);
+	return 0;
+}
@@ -0,0 +1,84 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	Times byte swapping an array of 16, 32 and 64 bit values in place,
+	one value at a time through SwitchEndian() as Socket and Buffer used to,
+	against SwitchEndianInPlace(), which swaps in bulk with whatever SIMD
+	the compiler targets.  swab() is there as a yardstick for 16 bit values.
+	Build with and without e.g. -mssse3 or -mavx2 to compare the kernels.
+
+	Only needs the headers, so e.g.
+		g++ -std=c++11 -O2 -Iinclude/socket bench/SwitchEndianBench.cpp
+
+	Usage: SwitchEndianBench [values]
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <unistd.h>
+#include "SwitchEndian.hpp"
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	//!Best of 20 runs, in microseconds.
+	template<typename F>
+	double Best(F f)
+	{
+		double best=1e9;
+		for(int run=0;run<20;run++)
+		{
+			Clock::time_point start=Clock::now();
+			f();
+			best=std::min(best,std::chrono::duration<double,std::micro>(Clock::now()-start).count());
+		}
+		return best;
+	}
+
+	template<typename T>
+	void OneAtATime(vector<T>& data)
+	{
+		std::transform(data.begin(),data.end(),data.begin(),SwitchEndian<T>);
+	}
+
+	template<typename T>
+	void InBulk(vector<T>& data)
+	{
+		SwitchEndianInPlace<sizeof(T)>(&data[0],data.size());
+	}
+
+	template<typename T>
+	void Run(const char* name,size_t count)
+	{
+		vector<T> data(count,T(0x12));
+		cout << name
+			<< "  one at a time " << Best([&]{OneAtATime(data);}) << " us"
+			<< ", in bulk " << Best([&]{InBulk(data);}) << " us" << endl;
+	}
+}
+
+int main(int argc,char* argv[])
+{
+	size_t count=argc>1 ? atoi(argv[1]) : 16*1024;
+	cout << count << " values" << endl;
+
+	vector<unsigned short> words(count,0x1234);
+	cout << "16 bit  swab " << Best([&]{swab(&words[0],&words[0],count*2);}) << " us" << endl;
+
+	Run<unsigned short>("16 bit",count);
+	Run<float>("32 bit",count);
+	Run<double>("64 bit",count);
+	return 0;
+}
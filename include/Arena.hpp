@@ -0,0 +1,183 @@
+#ifndef ARENA_HPP_INCLUDE_GUARD_2093847561
+#define ARENA_HPP_INCLUDE_GUARD_2093847561
+#include <stddef.h>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/type_traits.hpp>
+
+#include "Types.hpp"
+
+namespace dicom
+{
+	//!Monotonic allocator: hands out memory from a few large blocks, and never frees any of it individually.
+	/*!
+		Everything is given back in one go when the Arena is destroyed.  This
+		suits data sets that are decoded, looked at and thrown away, where
+		otherwise every element costs several small heap allocations, and as
+		many frees.
+
+		Not thread safe - an Arena belongs to one DataSet (and its sequence items).
+	*/
+	class Arena:boost::noncopyable
+	{
+		std::vector<BYTE*> blocks_;
+		BYTE* position_;
+		BYTE* end_;
+		size_t NextBlockSize_;
+
+		//!Objects made with Create() that need their destructors running when we go.
+		struct Finalizer
+		{
+			Finalizer* next_;
+			void (*destroy_)(Finalizer*);
+		};
+
+		template<typename T>
+		struct Owned:Finalizer
+		{
+			T object_;
+			Owned(const T& object):object_(object){}
+			static void Destroy(Finalizer* f)
+			{
+				static_cast<Owned*>(f)->~Owned();
+			}
+		};
+
+		Finalizer* finalizers_;
+
+		void* AllocateBlock(size_t size,size_t alignment);
+
+		static BYTE* Align(BYTE* p,size_t alignment)
+		{
+			return reinterpret_cast<BYTE*>((reinterpret_cast<size_t>(p)+alignment-1) & ~(alignment-1));
+		}
+
+	public:
+		//!FirstBlockSize is the size of the first block. Each block after that is twice as big, up to a limit.
+		explicit Arena(size_t FirstBlockSize=16*1024);
+		~Arena();
+
+		void* Allocate(size_t size,size_t alignment)
+		{
+			BYTE* p=Align(position_,alignment);
+			if(position_ && p+size<=end_)
+			{
+				position_=p+size;
+				return p;
+			}
+			return AllocateBlock(size,alignment);
+		}
+
+		//!Copy object into the Arena.  Its destructor is run when the Arena is destroyed.
+		template<typename T>
+		T* Create(const T& object)
+		{
+			if(boost::has_trivial_destructor<T>::value)
+				return new(Allocate(sizeof(T),boost::alignment_of<T>::value)) T(object);
+
+			Owned<T>* owned=new(Allocate(sizeof(Owned<T>),boost::alignment_of<Owned<T> >::value)) Owned<T>(object);
+			owned->destroy_=&Owned<T>::Destroy;
+			owned->next_=finalizers_;
+			finalizers_=owned;
+			return &owned->object_;
+		}
+
+		//!Number of blocks we've had to get from the heap.
+		size_t Blocks() const
+		{
+			return blocks_.size();
+		}
+	};
+
+	//!Like boost::make_shared, but the object is created in arena if we have one.
+	/*!
+		The object shares ownership of the arena itself, rather than having a
+		reference count of its own, so this costs no more than the object.  The
+		object lives until the arena does, even if the pointer goes away first,
+		so it mustn't hold a reference to arena itself.
+	*/
+	template<typename T>
+	boost::shared_ptr<T> MakeShared(const boost::shared_ptr<Arena>& arena,const T& object)
+	{
+		if(!arena)
+			return boost::make_shared<T>(object);
+		return boost::shared_ptr<T>(arena,arena->Create(object));
+	}
+
+	//!Standard allocator interface onto an Arena.
+	/*!
+		A default constructed ArenaAllocator just uses the heap, so containers
+		that use it behave as normal unless they've been given an Arena.
+
+		The allocator holds a reference to the Arena, so a container keeps its
+		Arena alive.
+
+		Copying a container doesn't copy the Arena along with it - the copy goes
+		on the heap, see select_on_container_copy_construction().
+	*/
+	template<typename T>
+	class ArenaAllocator
+	{
+		template<typename U> friend class ArenaAllocator;
+		boost::shared_ptr<Arena> arena_;
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		template<typename U>
+		struct rebind
+		{
+			typedef ArenaAllocator<U> other;
+		};
+
+		ArenaAllocator(){}
+		explicit ArenaAllocator(const boost::shared_ptr<Arena>& arena):arena_(arena){}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other):arena_(other.arena_){}
+
+		const boost::shared_ptr<Arena>& GetArena() const
+		{
+			return arena_;
+		}
+
+		T* allocate(size_t n)
+		{
+			if(!arena_)
+				return static_cast<T*>(::operator new(n*sizeof(T)));
+			return static_cast<T*>(arena_->Allocate(n*sizeof(T),boost::alignment_of<T>::value));
+		}
+
+		void deallocate(T* p,size_t)
+		{
+			if(!arena_)
+				::operator delete(p);
+		}
+
+		ArenaAllocator select_on_container_copy_construction() const
+		{
+			return ArenaAllocator();
+		}
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const
+		{
+			return arena_==other.arena_;
+		}
+
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const
+		{
+			return arena_!=other.arena_;
+		}
+	};
+
+}//namespace dicom
+
+#endif //ARENA_HPP_INCLUDE_GUARD_2093847561
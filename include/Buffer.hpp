@@ -11,6 +11,7 @@
 #include "Types.hpp"
 #include "Exceptions.hpp"
 #include "Tag.hpp"
+#include "ByteCursor.hpp"
 
 namespace dicom
 {
@@ -46,6 +47,10 @@ namespace dicom
 		We tried using std::deque to implement this, but took a big performance hit.
 		vector is the only guaranteed contiguous container, which means we can
 		directly pass data to socket and file functions.
+
+		Reading is now done by ByteCursor, which works on any contiguous range of
+		bytes.  The extraction operators here are kept as a thin adapter so that
+		existing code that reads from a Buffer carries on working.
     */
 
 	class Buffer : public std::vector<BYTE>, boost::noncopyable
@@ -68,7 +73,18 @@ namespace dicom
 		iterator position();
 		void Increment(size_type i);
 
-        Buffer& operator << (std::string data);
+		//!Appends length bytes in one go.
+		void Append(const BYTE* data,size_type length)
+		{
+			insert(this->end(),data,data+length);
+		}
+
+		Buffer& operator << (const std::string& data)
+		{
+			const BYTE* p=reinterpret_cast<const BYTE*>(data.data());
+			Append(p,data.size());
+			return *this;
+		}
 
 		template <typename T>
 		Buffer& operator << (T data)
@@ -79,35 +95,41 @@ namespace dicom
 			{
 				data=SwitchEndian<T>(data);
 			}
-			BYTE* pdata=reinterpret_cast<BYTE*> (&data);
-			for(BYTE* p=pdata;p<pdata+sizeof(T);p++)
+			Append(reinterpret_cast<const BYTE*>(&data),sizeof(T));
+			return *this;
+		}
+
+		//!Group and element go in as one store.
+		Buffer& operator << (Tag tag)
+		{
+			UINT16 words[2]={GroupTag(tag),ElementTag(tag)};
+			if(ExternalByteOrder_!=__BYTE_ORDER)
 			{
-				push_back(*p);
+				words[0]=SwitchEndian<UINT16>(words[0]);
+				words[1]=SwitchEndian<UINT16>(words[1]);
 			}
+			Append(reinterpret_cast<const BYTE*>(words),sizeof(words));
 			return *this;
 		}
 
-		Buffer& operator << (Tag tag);
+		//!A cursor over the unread part of the buffer.
+		/*!
+			This is invalidated by anything that might reallocate the
+			buffer, so don't hold onto it.  Call Increment(cursor.Offset())
+			when you're done to skip over whatever the cursor consumed.
+		*/
+		ByteCursor Cursor() const
+		{
+			const BYTE* p=empty()?0:&front();
+			return ByteCursor(p+I_,p+size(),ExternalByteOrder_);
+		}
 
 		template<typename T>
 		Buffer& operator >> (T& data)
 		{
-			BOOST_STATIC_ASSERT(!(::boost::is_const<T>::value));//because we're writing to it.
-			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);//because we're treating it as a byte stream.
-			BYTE* pdata=reinterpret_cast<BYTE*> (&data);
-
-			if(int(sizeof(T))>(end()-position()))
-				throw dicom::exception("Attempting to read beyond end of buffer");
-				for(BYTE* p=pdata;p<pdata+sizeof(T);p++)//this is tedious to have to check.
-			{
-				//can we do this with a copy?
-				*p=*position();
-				I_++;
-			}
-
-			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)!=1)
-				data=SwitchEndian<T>(data);
-
+			ByteCursor cursor=Cursor();
+			cursor>>data;
+			I_+=cursor.Offset();
 			return *this;
 		}
 
@@ -128,10 +150,25 @@ namespace dicom
 
 		void AddVector(const std::vector<BYTE>& data)
 		{
-			insert(this->end(),data.begin(),data.end());
+			if(!data.empty())
+				Append(&data[0],data.size());
 		}
 		void AddVector(const std::vector<UINT16>& data);
 
+		//!For OF, OD, OL and OV data.
+		template<typename T>
+		void AddVector(const std::vector<T>& data)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);
+			if(data.empty())
+				return;
+			const BYTE* p_data=reinterpret_cast<const BYTE*> (&data[0]);
+			size_type start=size();
+			insert(this->end(),p_data,p_data+data.size()*sizeof(T));
+			if(__BYTE_ORDER!=ExternalByteOrder_)
+				SwitchEndianInPlace<sizeof(T)>(&(*this)[start],data.size());
+		}
+
     };
 }
 
@@ -0,0 +1,192 @@
+#ifndef BYTE_CURSOR_HPP_INCLUDE_GUARD_4410973628
+#define BYTE_CURSOR_HPP_INCLUDE_GUARD_4410973628
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits.hpp>
+
+#include "socket/Base.hpp"
+#include "socket/SwitchEndian.hpp"
+#include "Types.hpp"
+#include "Exceptions.hpp"
+#include "Tag.hpp"
+
+namespace dicom
+{
+	//!A view onto a contiguous run of bytes owned by somebody else.
+	/*!
+		No copying takes place when one of these is created - it's just a
+		pair of pointers, so it's only valid for as long as the underlying
+		storage is.
+	*/
+	struct ByteSpan
+	{
+		const BYTE* begin_;
+		const BYTE* end_;
+
+		ByteSpan():begin_(0),end_(0){}
+		ByteSpan(const BYTE* begin,const BYTE* end):begin_(begin),end_(end){}
+
+		const BYTE* begin() const{return begin_;}
+		const BYTE* end() const{return end_;}
+		size_t size() const{return size_t(end_-begin_);}
+		bool empty() const{return begin_==end_;}
+	};
+
+	//!Read-only cursor over a contiguous range of encoded bytes.
+	/*!
+		This is what the Decoder actually reads from.  Unlike Buffer it
+		doesn't own anything, so it can sit on top of a Buffer, a file
+		that's been read into memory, or any other contiguous block of
+		bytes without us having to copy them first.
+
+		Fundamental types are pulled off with a single memcpy (plus a
+		byte swap if the external byte order differs from ours), rather
+		than one byte at a time.  Strings and OB/OW data can be taken as
+		a ByteSpan with Take(), which doesn't copy anything at all.
+
+		Every read is bounds checked against the end of the range, so a
+		corrupt length field results in an exception rather than a read
+		off the end of memory.
+	*/
+	class ByteCursor
+	{
+		const BYTE* begin_;
+		const BYTE* end_;
+		const BYTE* position_;
+
+		void Require(size_t n) const
+		{
+			if(n>size_t(end_-position_))
+				throw dicom::exception("Attempting to read beyond end of buffer");
+		}
+
+	public:
+		const int ExternalByteOrder_;
+
+		ByteCursor(const BYTE* begin,const BYTE* end,int ExternalByteOrder)
+			:begin_(begin),end_(end),position_(begin),ExternalByteOrder_(ExternalByteOrder){}
+
+		const BYTE* begin() const{return begin_;}
+		const BYTE* end() const{return end_;}
+		const BYTE* position() const{return position_;}
+
+		//!Number of bytes read so far.
+		size_t Offset() const{return size_t(position_-begin_);}
+
+		//!Number of bytes left to read.
+		size_t Remaining() const{return size_t(end_-position_);}
+
+		bool AtEnd() const{return position_==end_;}
+
+		void Increment(size_t i)
+		{
+			Require(i);
+			position_+=i;
+		}
+
+		//!Returns a view onto the next 'length' bytes, and steps over them.
+		ByteSpan Take(size_t length)
+		{
+			Require(length);
+			ByteSpan span(position_,position_+length);
+			position_+=length;
+			return span;
+		}
+
+		template<typename T>
+		ByteCursor& operator >> (T& data)
+		{
+			BOOST_STATIC_ASSERT(!(::boost::is_const<T>::value));//because we're writing to it.
+			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);//because we're treating it as a byte stream.
+
+			Require(sizeof(T));
+			memcpy(&data,position_,sizeof(T));
+			position_+=sizeof(T);
+
+			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)!=1)
+				data=SwitchEndian<T>(data);
+
+			return *this;
+		}
+
+		ByteCursor& operator >>(Tag& tag)
+		{
+			UINT16 Group;
+			UINT16 Element;
+			*this >> Group;
+			*this >> Element;
+			tag = makeTag(Group,Element);
+			return *this;
+		}
+
+		//!data must already be the required length.
+		ByteCursor& operator >>(std::string& data)
+		{
+			Require(data.size());
+			if(!data.empty())
+				memcpy(&data[0],position_,data.size());
+			position_+=data.size();
+			return *this;
+		}
+
+		//!data must already be the required length.
+		ByteCursor& operator >>(std::vector<BYTE>& data)
+		{
+			Require(data.size());
+			if(!data.empty())
+				memcpy(&data[0],position_,data.size());
+			position_+=data.size();
+			return *this;
+		}
+
+		//!data must already be the required length.
+		ByteCursor& operator >>(std::vector<UINT16>& data)
+		{
+			Require(data.size()*2);
+			if(!data.empty())
+			{
+				memcpy(&data[0],position_,data.size()*2);
+				if(ExternalByteOrder_!=__BYTE_ORDER)
+					SwitchVectorEndian(data);
+			}
+			position_+=data.size()*2;
+			return *this;
+		}
+
+		//!data must already be the required length.  For OF, OD, OL and OV.
+		template<typename T>
+		ByteCursor& operator >>(std::vector<T>& data)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);
+
+			Require(data.size()*sizeof(T));
+			if(!data.empty())
+			{
+				memcpy(&data[0],position_,data.size()*sizeof(T));
+				if(ExternalByteOrder_!=__BYTE_ORDER)
+					SwitchVectorEndian(data);
+			}
+			position_+=data.size()*sizeof(T);
+			return *this;
+		}
+
+		//!Reads count values onto data, swapping them all in one go if need be.
+		template<typename T>
+		void Read(T* data,size_t count)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);
+
+			Require(count*sizeof(T));
+			memcpy(data,position_,count*sizeof(T));
+			position_+=count*sizeof(T);
+
+			if(ExternalByteOrder_!=__BYTE_ORDER)
+				SwitchEndianInPlace<sizeof(T)>(data,count);
+		}
+	};
+}//namespace dicom
+
+#endif //BYTE_CURSOR_HPP_INCLUDE_GUARD_4410973628
@@ -63,7 +63,8 @@ namespace dicom
 		ClientConnection(std::string Host, unsigned short Port,
 			std::string LocalAET,std::string RemoteAET,
 			//const std::vector<PresentationContext>& ProposedPresentationContexts);
-			const PresentationContexts& ProposedPresentationContexts);
+			const PresentationContexts& ProposedPresentationContexts,
+			UINT32 MaxPDULength=DefaultMaxPDULength);//see ServiceBase::MaxPDULength_
 		virtual ~ClientConnection();
 
 		//!Send a dataset, return response  (i.e. perform a C-STORE)
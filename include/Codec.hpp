@@ -0,0 +1,77 @@
+#ifndef CODEC_HPP_INCLUDE_GUARD_5518093427
+#define CODEC_HPP_INCLUDE_GUARD_5518093427
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Types.hpp"
+#include "UID.hpp"
+#include "ByteCursor.hpp"
+#include "DataSet.hpp"
+#include "TransferSyntax.hpp"
+#include "PixelData.hpp"
+
+namespace dicom
+{
+	//!Compresses and decompresses frames of pixel data for one encapsulated transfer syntax.
+	/*!
+		Implement this to plug in a codec, and register it with RegisterCodec().
+		A native frame is ImageFormat::FrameSize() bytes in our byte order,
+		with samples interleaved or planar as the ImageFormat says.  Each
+		compressed frame is a single fragment.
+
+		Codecs are shared between threads, so these must be safe to call
+		concurrently.
+	*/
+	class PixelCodec
+	{
+	public:
+		virtual ~PixelCodec(){}
+
+		//!Compresses frame, appending the fragment onto fragment.
+		virtual void EncodeFrame(const BYTE* frame,const ImageFormat& format,std::vector<BYTE>& fragment) const=0;
+
+		//!Decompresses fragment into frame, which has room for format.FrameSize() bytes.
+		virtual void DecodeFrame(ByteSpan fragment,const ImageFormat& format,BYTE* frame) const=0;
+	};
+
+	//!Makes transfer_syntax known as an encapsulated transfer syntax, compressed and decompressed by codec.
+	/*!
+		Once this is done TS accepts transfer_syntax, and isEncoded() is true
+		for it.  This replaces any codec already registered for it.
+
+		codec may be null, in which case data sets in transfer_syntax can be
+		read and written with their pixel data as it is, but not transcoded.
+		That's how JPEG Baseline and JPEG Lossless come registered.  RLE
+		Lossless comes with a codec, see RLE.hpp.
+	*/
+	void RegisterCodec(const UID& transfer_syntax,boost::shared_ptr<const PixelCodec> codec);
+
+	//!Has transfer_syntax been registered, with or without a codec?
+	bool IsRegisteredCodec(const UID& transfer_syntax);
+
+	//!The codec registered for transfer_syntax, or null if there isn't one.
+	boost::shared_ptr<const PixelCodec> FindCodec(const UID& transfer_syntax);
+
+	//!Does data's pixel data have to be transcoded before it's written in transfer_syntax?
+	/*!
+		That's when it's compressed in some other transfer syntax (see
+		DataSet::PixelDataSyntax()), or when it's native but transfer_syntax
+		is encapsulated and has a codec.  Native pixel data is the same in
+		every native transfer syntax, as the Encoder takes care of byte order.
+	*/
+	bool NeedsTranscoding(const DataSet& data,TS transfer_syntax);
+
+	//!Converts the pixel data of data to transfer_syntax.
+	/*!
+		Compressed pixel data is decompressed with its own codec, and then if
+		transfer_syntax is encapsulated, compressed with that one's.  Throws
+		if a codec's needed and not registered.  Does nothing if
+		NeedsTranscoding() is false.
+
+		The data set's other attributes, e.g. Photometric Interpretation for
+		a codec that changes colour space, are left for the caller.
+	*/
+	void Transcode(DataSet& data,TS transfer_syntax);
+
+}//namespace dicom
+
+#endif //CODEC_HPP_INCLUDE_GUARD_5518093427
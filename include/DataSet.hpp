@@ -11,6 +11,9 @@
 #include "VR.hpp"
 #include "Value.hpp"
 #include "Tag.hpp"
+#include "UID.hpp"
+#include "ByteCursor.hpp"
+#include "Arena.hpp"
 
 namespace dicom
 {
@@ -25,6 +28,30 @@ namespace dicom
 		virtual ~TagNotFound() throw() {}
 	};
 
+	//!Where the undecoded bytes of a lazily read DataSet live.
+	/*!
+		Owner_ keeps the bytes alive for as long as any DataSet (or copy of one)
+		still has elements waiting to be decoded from them.
+	*/
+	struct DeferredSource
+	{
+		boost::shared_ptr<const void> Owner_;
+		UID TransferSyntax_;
+		int ByteOrder_;
+		//!See DecodeOptions::ReferenceBulkData_
+		bool ReferenceBulkData_;
+	};
+
+	//!An element that has been located, but whose value hasn't been decoded yet.
+	struct DeferredElement
+	{
+		VR vr_;
+		//!As it appeared in the element header, so may be UNDEFINED_LENGTH.
+		UINT32 length_;
+		//!The value bytes, including any items and delimiters if length_ is undefined.
+		ByteSpan value_;
+	};
+
 	//!Set of DICOM data elements
 	/*!
 
@@ -38,11 +65,81 @@ namespace dicom
 	always use any of the functions that std::multimap provides, such
 	as equal_range(), count() and find()
 
+	A DataSet constructed with an Arena allocates its elements, and their
+	values, from that Arena.  Decoding onto such a DataSet then takes a
+	handful of large allocations rather than several small ones per element,
+	and everything is freed in one go.  Sequence items decoded onto it share
+	its Arena.  Copies of the DataSet use the heap as usual.
+
+	A DataSet read with DecodeOptions::Lazy_ set only records where each
+	element is on the first pass.  Values are decoded when they are first
+	asked for through operator() or Values().  The std::multimap functions
+	only see elements that have already been decoded, so call Materialize()
+	before iterating over such a DataSet.
+
+	Because decoding on access changes the DataSet underneath, a lazily read
+	DataSet must only be used from one thread at a time, const or not, until
+	Materialize() has been called.  After that it's an ordinary DataSet.
+	The one exception is the Encoder, which decodes anything it needs to on
+	a copy, so encoding doesn't count as a use: the same DataSet can be
+	written out on several associations at once.
+
+	Encoding a lazily read DataSet copies every element that is still
+	undecoded straight from the original bytes, provided the transfer
+	syntax allows it (see the Encoder).  Only elements that have been
+	asked for, added or changed are encoded from their Values, so
+	forwarding a data set with a few attributes changed costs little more
+	than a copy.
 */
-	class DataSet:public std::multimap<Tag,Value>
+	class DataSet:public std::multimap<Tag,Value,std::less<Tag>,ArenaAllocator<std::pair<const Tag,Value> > >
 	{
+		template<typename> friend struct BasicDecoder;
+		template<typename,typename> friend class BasicEncoder;
+
+		typedef std::multimap<Tag,Value,std::less<Tag>,ArenaAllocator<std::pair<const Tag,Value> > > Elements;
+
+		typedef std::multimap<Tag,DeferredElement> DeferredElements;
+
+		//!Elements that have been indexed but not decoded yet.
+		/*!
+			Decoding an element doesn't change the logical contents of the
+			DataSet, which is why this (and Materialize()) are const.  It does
+			change the multimap though, see the threading note above.
+		*/
+		mutable DeferredElements Deferred_;
+		mutable boost::shared_ptr<const DeferredSource> Source_;
+
+		//!See OffsetTable()
+		std::vector<UINT32> OffsetTable_;
+
+		//!See PixelDataSyntax()
+		UID PixelDataSyntax_;
+
 	public:
 
+		DataSet(){}
+
+		//!Allocate everything from arena, see above.
+		explicit DataSet(const boost::shared_ptr<Arena>& arena)
+			:Elements(std::less<Tag>(),allocator_type(arena))
+		{
+		}
+
+		//!The Arena we allocate from, if any.
+		boost::shared_ptr<Arena> GetArena() const
+		{
+			return get_allocator().GetArena();
+		}
+
+		//!Exchanges contents (and Arenas) with other, without copying any elements.
+		void swap(DataSet& other)
+		{
+			Elements::swap(other);
+			Deferred_.swap(other.Deferred_);
+			Source_.swap(other.Source_);
+			OffsetTable_.swap(other.OffsetTable_);
+			std::swap(PixelDataSyntax_,other.PixelDataSyntax_);
+		}
 
 		//!access an element
 		/*!
@@ -55,11 +152,109 @@ namespace dicom
 		const Value& operator()(const Tag tag) const
         {
             const_iterator element=find(tag);
+            if(element==end() && Materialize(tag))
+				element=find(tag);
             if(element==end())
                 throw TagNotFound(tag);
 			return element->second;
 		}
 
+		//!Decode any deferred elements matching tag.  Returns false if there weren't any.
+		bool Materialize(const Tag tag) const
+		{
+			if(Deferred_.empty())
+				return false;
+			return MaterializeDeferred(tag);
+		}
+
+		//!Decode every deferred element, after which this is an ordinary DataSet.
+		void Materialize() const;
+
+		//!Has this DataSet got elements that haven't been decoded yet?
+		bool HasDeferred() const
+		{
+			return !Deferred_.empty();
+		}
+
+		//!The first undecoded element with this tag, or 0 if there isn't one.
+		/*!
+			This lets big values, such as the pixel data, be looked at where
+			they are without decoding them.  See FrameIndex.
+		*/
+		const DeferredElement* FindDeferred(const Tag tag) const
+		{
+			DeferredElements::const_iterator I=Deferred_.find(tag);
+			return I==Deferred_.end() ? 0 : &I->second;
+		}
+
+		//!Where the undecoded elements are, which keeps their bytes alive.
+		const boost::shared_ptr<const DeferredSource>& GetDeferredSource() const
+		{
+			return Source_;
+		}
+
+		//!The Basic Offset Table of encapsulated pixel data, as it was read.
+		/*!
+			Each entry is the offset from the first fragment's item tag to the
+			first fragment of a frame, see Part 5, Annex A.4.  It's empty if
+			the pixel data isn't encapsulated, or if the table was.
+
+			The Encoder writes this back out if it still fits the fragments,
+			and otherwise works out a new one.
+		*/
+		const std::vector<UINT32>& OffsetTable() const
+		{
+			Materialize(TAG_PIXEL_DATA);
+			return OffsetTable_;
+		}
+
+		void SetOffsetTable(const std::vector<UINT32>& table)
+		{
+			OffsetTable_=table;
+		}
+
+		//!The encapsulated transfer syntax the pixel data is compressed in.
+		/*!
+			This is set when encapsulated pixel data is decoded, and by
+			Transcode().  It's empty if the pixel data is native, or if its
+			fragments were put here by hand.
+		*/
+		UID PixelDataSyntax() const
+		{
+			const DeferredElement* deferred=FindDeferred(TAG_PIXEL_DATA);
+			if(deferred && UNDEFINED_LENGTH==deferred->length_)
+				return Source_->TransferSyntax_;
+			return PixelDataSyntax_;
+		}
+
+		void SetPixelDataSyntax(const UID& transfer_syntax)
+		{
+			PixelDataSyntax_=transfer_syntax;
+		}
+
+		void clear()
+		{
+			Elements::clear();
+			Deferred_.clear();
+			Source_.reset();
+			OffsetTable_.clear();
+			PixelDataSyntax_=UID();
+		}
+
+		using Elements::erase;
+
+		//!Remove every element matching tag, including any that haven't been decoded yet.
+		size_type erase(const Tag& tag)
+		{
+			Deferred_.erase(tag);
+			if(TAG_PIXEL_DATA==tag)
+			{
+				OffsetTable_.clear();
+				PixelDataSyntax_=UID();
+			}
+			return Elements::erase(tag);
+		}
+
  		//!Insert an element
 		/*! I'd rather that the function signature was:
 				template <VR vr>
@@ -70,7 +265,8 @@ namespace dicom
 		void Put(Tag tag, const T& data)
 		{
 			StaticVRCheck<T,vr>();
-			Value v(vr,data);
+			Materialize(tag);//so a deferred value doesn't turn up alongside this one later.
+			Value v(vr,data,GetArena());
 			insert(value_type(tag,v));
 		}
         
@@ -81,12 +277,16 @@ namespace dicom
 		*/        
         std::vector<Value> Values(const Tag tag) const
         {
+			Materialize(tag);
 			std::pair<const_iterator,const_iterator> P = equal_range(tag);
 			std::vector<Value> v;   
 			for(const_iterator I=P.first;I!=P.second;I++)
 				v.push_back(I->second);
 			return v;
         }
+
+	private:
+		bool MaterializeDeferred(const Tag tag) const;
 	};
 
 	
@@ -1,11 +1,17 @@
 #ifndef DECODER_HPP_INCLUDE_GUARD_5823561955
 #define DECODER_HPP_INCLUDE_GUARD_5823561955
 
+#include <set>
+#include <boost/scoped_ptr.hpp>
+
 #include "DataSet.hpp"
+#include "FlatDataSet.hpp"
 #include "socket/Socket.hpp"
 #include "TransferSyntax.hpp"
 #include "Exceptions.hpp"
 #include "Buffer.hpp"
+#include "ByteCursor.hpp"
+#include "Deflate.hpp"
 /*
 	TODO
 	
@@ -24,10 +30,151 @@ namespace dicom
 		virtual ~DecoderError()throw(){}
 	};
 	
+	//!Optional behaviour for ReadFromBuffer() and ReadFromStream()
+	struct DecodeOptions
+	{
+		//!Only index elements on the first pass, decoding each Value the first time it's asked for.
+		/*!
+			This is much cheaper when only a handful of attributes are wanted,
+			e.g. PatientID and StudyInstanceUID for indexing.  See DataSet for
+			the caveats.
+		*/
+		bool Lazy_;
+
+		//!Stop at the first top level element with this tag or greater.
+		/*!
+			Elements are encoded in tag order, so setting this to e.g. TAG_PIXEL_DATA
+			means we never even read the pixel data.  The default reads everything.
+		*/
+		Tag StopTag_;
+
+		//!If this isn't empty, only these top level elements are decoded.
+		/*!
+			Everything else is stepped over, and we stop once we're past the last
+			one in the list.
+		*/
+		std::set<Tag> Tags_;
+
+		//!Leave OB and OW values where they are, rather than copying them.
+		/*!
+			The Values then refer straight into the bytes being decoded (see
+			ExternalBytes), so as with Lazy_ an owner has to be provided.  Values
+			whose bytes would need swapping are still copied.
+		*/
+		bool ReferenceBulkData_;
+
+		//!If this isn't empty, the pixel data is transcoded to this transfer syntax once it's read.
+		/*!
+			e.g. EXPL_VR_LE_TRANSFER_SYNTAX to always get native pixel data.
+			See Transcode().  Not for FlatDataSets.
+		*/
+		UID TranscodeTo_;
+
+		DecodeOptions():Lazy_(false),StopTag_(Tag(0xffffffff)),ReferenceBulkData_(false){}
+
+		//!Are we asking for less than the whole data set?
+		bool Partial() const
+		{
+			return StopTag_!=Tag(0xffffffff) || !Tags_.empty();
+		}
+
+		//!Have we gone past the last top level element we're interested in?
+		bool PastEnd(Tag tag) const
+		{
+			return tag>=StopTag_ || (!Tags_.empty() && tag>*Tags_.rbegin());
+		}
+
+		//!Do we want this top level element decoded?
+		bool Wanted(Tag tag) const
+		{
+			return Tags_.empty() || Tags_.count(tag)!=0;
+		}
+	};
+
 	//!This function seems only to be used by FileMetaInformation
 	void ReadElementFromBuffer(Buffer& buffer, DataSet& data,TS transfer_syntax);
+	void ReadElementFromBuffer(ByteCursor& cursor, DataSet& data,TS transfer_syntax);
 	
 	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax);
 
+	//!Decode straight from a range of bytes, without copying them onto a Buffer first.
+	/*!
+		If transfer_syntax is deflated, everything left in cursor is inflated
+		first.  This goes for all of the ReadFromBuffer() functions.
+	*/
+	void ReadFromBuffer(ByteCursor& cursor, DataSet& data, TS transfer_syntax);
+
+	//!As above, with options.
+	/*!
+		If options.Lazy_ or options.ReferenceBulkData_ is set then owner must
+		keep the bytes behind cursor alive.  data holds on to it for as long
+		as it needs them.
+
+		If options.Partial() then the cursor may be left anywhere after the
+		last element we were interested in.
+	*/
+	void ReadFromBuffer(ByteCursor& cursor, DataSet& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner=boost::shared_ptr<const void>());
+
+	//!FlatDataSet versions of the above.  FlatDataSets can't be decoded lazily.
+	void ReadFromBuffer(ByteCursor& cursor, FlatDataSet& data, TS transfer_syntax);
+	void ReadFromBuffer(ByteCursor& cursor, FlatDataSet& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner=boost::shared_ptr<const void>());
+
+	//!Decodes a data set that arrives a piece at a time, e.g. off the network.
+	/*!
+		Feed() it bytes in chunks of any size.  Each top level element is
+		decoded onto the DataSet as soon as all of its bytes have arrived, so
+		parsing overlaps with receiving, and all we hold onto is the part of
+		an element that's still incomplete.
+
+		\code
+			DataSet data;
+			IncrementalDecoder decoder(data,ts);
+			while(more data)
+				decoder.Feed(chunk_begin,chunk_end);
+			decoder.Finish();
+		\endcode
+
+		Lazy decoding and referencing bulk data aren't possible, because the
+		bytes don't stay around.
+
+		A deflated data set is inflated as it arrives.
+	*/
+	class IncrementalDecoder
+	{
+	public:
+		IncrementalDecoder(DataSet& data,TS transfer_syntax);
+
+		//!Decodes whatever elements [begin,end) completes.  Returns how many that was.
+		size_t Feed(const BYTE* begin,const BYTE* end);
+
+		//!Call this when there's no more data.  Throws if we've got part of an element left over.
+		void Finish();
+
+		//!Number of bytes received that aren't decoded yet.
+		size_t Buffered() const
+		{
+			return pending_.size();
+		}
+
+	private:
+		const BYTE* DecodeComplete(const BYTE* begin,const BYTE* end,size_t& decoded);
+
+		DataSet& data_;
+		TS ts_;
+		int ByteOrder_;
+
+		//!An incomplete element.
+		std::vector<BYTE> pending_;
+
+		//!pending_ can't possibly hold a complete element until it's at least this big.
+		size_t needed_;
+
+		//!Only if the transfer syntax is deflated.
+		boost::scoped_ptr<Inflater> inflater_;
+		std::vector<BYTE> inflated_;
+	};
+
 }//namespace dicom
 #endif //DECODER_HPP_INCLUDE_GUARD_5823561955
@@ -0,0 +1,72 @@
+#ifndef DEFLATE_HPP_INCLUDE_GUARD_2093847561
+#define DEFLATE_HPP_INCLUDE_GUARD_2093847561
+#include <vector>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "Types.hpp"
+#include "EncoderSink.hpp"
+
+//zlib's stream state, which we keep out of our headers.
+struct z_stream_s;
+
+namespace dicom
+{
+	/*
+		The Deflated Explicit VR Little Endian transfer syntax (Part 5, Annex
+		A.5) is Explicit VR Little Endian, compressed with deflate (RFC 1951)
+		- with no zlib header or trailer.  Only the data set is compressed,
+		not the File Meta Information in front of it.
+
+		The Encoder and Decoder do this for themselves whenever they're given
+		this transfer syntax, so these are only needed directly to change the
+		compression level, or to handle deflated bytes some other way.
+	*/
+
+	//!zlib's default, which is a good trade between size and speed.  0 is no compression, 9 the most.
+	const int DefaultDeflateLevel=-1;
+
+	//!Compresses whatever is written to it, and passes it on to another EncoderSink.
+	/*!
+		As with EncoderOutput, every block passed on is exactly BlockSize bytes
+		apart from the last, so next can still send each one as a PDV.
+	*/
+	class DeflateSink : public EncoderSink, boost::noncopyable
+	{
+	public:
+		DeflateSink(EncoderSink& next,int level=DefaultDeflateLevel,size_t BlockSize=DefaultEncoderBlockSize);
+		~DeflateSink();
+		void Write(const BYTE* data,size_t length,bool last);
+	private:
+		void Flush(bool last);
+
+		EncoderSink& next_;
+		boost::scoped_ptr<z_stream_s> stream_;
+		std::vector<BYTE> block_;
+	};
+
+	//!Decompresses deflated bytes, a piece at a time.
+	class Inflater : boost::noncopyable
+	{
+	public:
+		Inflater();
+		~Inflater();
+
+		//!Appends what [begin,end) decompresses to onto out.
+		void Inflate(const BYTE* begin,const BYTE* end,std::vector<BYTE>& out);
+
+		//!Have we seen the end of the compressed data?
+		bool Finished() const
+		{
+			return finished_;
+		}
+	private:
+		boost::scoped_ptr<z_stream_s> stream_;
+		bool finished_;
+	};
+
+	//!Decompresses all of [begin,end) onto out.  Throws if that isn't a whole deflate stream.
+	void Inflate(const BYTE* begin,const BYTE* end,std::vector<BYTE>& out);
+
+}//namespace dicom
+
+#endif //DEFLATE_HPP_INCLUDE_GUARD_2093847561
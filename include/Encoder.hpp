@@ -2,9 +2,12 @@
 #define ENCODER_HPP_INCLUDE_GUARD_5729564748
 #include <exception>
 #include "DataSet.hpp"
+#include "FlatDataSet.hpp"
 #include "socket/Socket.hpp"
 #include "TransferSyntax.hpp"
 #include "Buffer.hpp"
+#include "EncoderSink.hpp"
+#include "Deflate.hpp"
 /*
 	As the following class basically only performs one job,
 	maybe it should expose itself as a simple function call?
@@ -16,7 +19,44 @@ namespace dicom
 
 
 
+	//!Number of bytes data takes up when encoded with transfer_syntax.
+	/*!
+		This walks the data set without writing anything, so it's a cheap way
+		of getting group lengths, or explicit sequence and item lengths.
+	*/
+	size_t EncodedLength(const DataSet& data, TS transfer_syntax);
+	size_t EncodedLength(const FlatDataSet& data, TS transfer_syntax);
+
+	//!Appends the encoding of data onto buffer.
+	/*!
+		We don't size the buffer with EncodedLength() first - for a typical
+		header that walk costs more than the reallocations it saves, and a
+		big vector such as the pixel data grows the buffer in one step
+		anyway.  See bench/PresizeBench.cpp.
+
+		A deflated transfer syntax is compressed with DefaultDeflateLevel.
+
+		If the pixel data of a DataSet isn't in transfer_syntax already, a
+		copy is transcoded and written instead, see NeedsTranscoding().
+		FlatDataSets are written as they are.
+	*/
 	void WriteToBuffer(const DataSet& data, Buffer& buffer, TS transfer_syntax);
+	void WriteToBuffer(const FlatDataSet& data, Buffer& buffer, TS transfer_syntax);
+
+	//!Encodes data a block at a time, passing each block on to sink as soon as it's full.
+	/*!
+		Unlike WriteToBuffer(), this never holds more than BlockSize encoded
+		bytes, however big the data set.  See EncoderOutput.
+
+		If transfer_syntax is deflated, sink gets the compressed bytes, still
+		in blocks of BlockSize.  DeflateLevel is only used then, see DeflateSink.
+
+		Pixel data is transcoded as for WriteToBuffer().
+	*/
+	void WriteToSink(const DataSet& data, EncoderSink& sink, TS transfer_syntax,
+		size_t BlockSize=DefaultEncoderBlockSize, int DeflateLevel=DefaultDeflateLevel);
+	void WriteToSink(const FlatDataSet& data, EncoderSink& sink, TS transfer_syntax,
+		size_t BlockSize=DefaultEncoderBlockSize, int DeflateLevel=DefaultDeflateLevel);
 
 }//namespace dicom
 
@@ -0,0 +1,185 @@
+#ifndef ENCODER_SINK_HPP_INCLUDE_GUARD_3180575294
+#define ENCODER_SINK_HPP_INCLUDE_GUARD_3180575294
+#include <string.h>
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits.hpp>
+
+#include "socket/Base.hpp"
+#include "socket/SwitchEndian.hpp"
+#include "Types.hpp"
+#include "Tag.hpp"
+
+namespace dicom
+{
+	//!Somewhere for the Encoder to send encoded bytes to, as they're produced.
+	/*!
+		Implement this to encode directly onto a file, a socket or anything
+		else, without the whole encoded data set having to be held in memory
+		first.  See EncoderOutput, which collects the bytes into blocks
+		before passing them on.
+	*/
+	class EncoderSink
+	{
+	public:
+		virtual ~EncoderSink(){}
+
+		//!Receives the next block of encoded bytes.
+		/*!
+			last is set on the final call, which may have fewer bytes than
+			the others, or none at all.
+		*/
+		virtual void Write(const BYTE* data,size_t length,bool last)=0;
+	};
+
+	//!Writes encoded bytes to a std::ostream.
+	class StreamSink : public EncoderSink
+	{
+		std::ostream& out_;
+	public:
+		explicit StreamSink(std::ostream& out):out_(out){}
+		void Write(const BYTE* data,size_t length,bool last);
+	};
+
+	//!Writes encoded bytes to an open file descriptor, such as a file or a pipe.
+	class FileDescriptorSink : public EncoderSink
+	{
+		int fd_;
+	public:
+		explicit FileDescriptorSink(int fd):fd_(fd){}
+		void Write(const BYTE* data,size_t length,bool last);
+	};
+
+	//!Default size of the block that EncoderOutput collects bytes in.
+	const size_t DefaultEncoderBlockSize=64*1024;
+
+	//!Fixed size block that the Encoder writes into, and that is handed on to an EncoderSink whenever it fills up.
+	/*!
+		This has the same output interface as Buffer, so the Encoder can write
+		to either.  However big the data set is, no more than BlockSize bytes
+		are held at any one time.
+
+		Every block passed to the sink is exactly BlockSize bytes long apart
+		from the last one, which is only sent once Finish() is called.  So the
+		sink can, for instance, send each block as a single PDV.
+
+		The block starts small and grows as it fills, up to BlockSize, so a
+		big BlockSize costs nothing when what's encoded is small, e.g. a
+		command set.
+	*/
+	class EncoderOutput : boost::noncopyable
+	{
+		EncoderSink& sink_;
+		const size_t BlockSize_;
+		std::vector<BYTE> block_;
+		size_t used_;
+
+		//!How much more fits in this block, once it's grown to full size.
+		size_t Space() const
+		{
+			return BlockSize_-used_;
+		}
+
+		//!Make sure the block has room for length more bytes.  They must fit in Space().
+		BYTE* Reserve(size_t length)
+		{
+			if(used_+length>block_.size())
+				Grow(used_+length);
+			return &block_[used_];
+		}
+
+		void Grow(size_t size);
+		void Flush();
+		void AppendSlow(const BYTE* data,size_t length);
+
+	public:
+		const int ExternalByteOrder_;
+
+		EncoderOutput(EncoderSink& sink,int ExternalByteOrder,size_t BlockSize=DefaultEncoderBlockSize);
+
+		//!Sends whatever is left to the sink, as the last block.
+		void Finish();
+
+		//!Copies length bytes, passing full blocks on to the sink as we go.
+		void Append(const BYTE* data,size_t length)
+		{
+			if(used_+length<=block_.size())
+			{
+				if(length)
+					memcpy(&block_[used_],data,length);
+				used_+=length;
+			}
+			else
+				AppendSlow(data,length);
+		}
+
+		template <typename T>
+		EncoderOutput& operator << (T data)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);//because we're treating it as a byte stream.
+
+			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)!=1)
+				data=SwitchEndian<T>(data);
+			Append(reinterpret_cast<const BYTE*>(&data),sizeof(T));
+			return *this;
+		}
+
+		EncoderOutput& operator << (Tag tag)
+		{
+			*this << GroupTag(tag);
+			*this << ElementTag(tag);
+			return *this;
+		}
+
+		EncoderOutput& operator << (const std::string& data)
+		{
+			Append(reinterpret_cast<const BYTE*>(data.data()),data.size());
+			return *this;
+		}
+
+		//!OB, OW, OF, OD, OL, OV and UN data.
+		/*!
+			Values are swapped in the block, as they're copied in, so we never
+			need a swapped copy of the whole vector.
+		*/
+		template<typename T>
+		void AddVector(const std::vector<T>& data)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);
+			if(data.empty())
+				return;
+			const T* p=&data[0];
+			size_t count=data.size();
+			if(__BYTE_ORDER==ExternalByteOrder_ || 1==sizeof(T))
+			{
+				Append(reinterpret_cast<const BYTE*>(p),count*sizeof(T));
+				return;
+			}
+			while(count)
+			{
+				size_t fit=std::min(Space()/sizeof(T),count);
+				if(0==fit)
+				{
+					//the next value straddles two blocks.
+					*this << *p++;
+					count--;
+					continue;
+				}
+				BYTE* dest=Reserve(fit*sizeof(T));
+				memcpy(dest,p,fit*sizeof(T));
+				SwitchEndianInPlace<sizeof(T)>(dest,fit);
+				used_+=fit*sizeof(T);
+				p+=fit;
+				count-=fit;
+			}
+		}
+	};
+
+}//namespace dicom
+
+#endif //ENCODER_SINK_HPP_INCLUDE_GUARD_3180575294
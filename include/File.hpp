@@ -4,6 +4,7 @@
 #include "UIDs.hpp"
 #include "Exceptions.hpp"
 #include "FileMetaInformation.hpp"
+#include "Decoder.hpp"
 #include <fstream>
 namespace dicom
 {
@@ -44,14 +45,26 @@ namespace dicom
 	};
 
 
-    void ReadFromStream(std::istream &In, DataSet& data);
+    void ReadFromStream(std::istream &In, DataSet& data, const DecodeOptions& options=DecodeOptions());
 
-	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX)/*::IMPL_VR_LE*/);
+	//!DeflateLevel is only used if ts is deflated, see DeflateSink.
+	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX)/*::IMPL_VR_LE*/,
+		int DeflateLevel=DefaultDeflateLevel);
 
 
-    void Read(std::string FileName,DataSet& data);
+    void Read(std::string FileName,DataSet& data, const DecodeOptions& options=DecodeOptions());
     void Read(std::istream in, DataSet& data);
-	void Write(const DataSet& data, std::string FileName, TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX));//why implicit?
+
+	//!As Read(), but decodes straight out of a memory mapping of the file.
+	/*!
+		Nothing is copied up front, and OB/OW values such as pixel data are
+		left in the mapping (see ExternalBytes), which stays open for as long
+		as data or any of those values are alive.  Don't truncate the file
+		while that's the case.
+	*/
+	void ReadMapped(std::string FileName, DataSet& data, const DecodeOptions& options=DecodeOptions());
+	void Write(const DataSet& data, std::string FileName, TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX),//why implicit?
+		int DeflateLevel=DefaultDeflateLevel);
 
 }//namespace dicom
 
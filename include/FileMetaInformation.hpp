@@ -31,6 +31,8 @@ namespace dicom
 			-construct with the intention of writing _to_ a stream.
 		*/
 		FileMetaInformation(std::istream& In);
+		//!Read from bytes that are already in memory, leaving In just past the meta information.
+		FileMetaInformation(ByteCursor& In);
 		//FileMetaInformation(const UID& classUID, const UID& instUID, TS ts);
 		//!Infer instance and class UIDs from data set
 		FileMetaInformation(const DataSet& data,TS ts);
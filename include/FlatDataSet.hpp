@@ -0,0 +1,197 @@
+#ifndef FLAT_DATA_SET_HPP_INCLUDE_GUARD_6618204397
+#define FLAT_DATA_SET_HPP_INCLUDE_GUARD_6618204397
+
+#include <vector>
+#include <algorithm>
+#include "DataSet.hpp"
+
+namespace dicom
+{
+	//!Set of DICOM data elements, kept in a single vector sorted by tag.
+	/*!
+		This offers the same interface as DataSet - Put(), operator(), Values(),
+		find(), count(), equal_range() and iteration in tag order - but
+		without a tree node per element.  Lookups are a binary search over
+		contiguous memory.
+
+		Elements are encoded in tag order, so when decoding every Put() is an
+		append.  Putting elements in any other order works, but each one costs
+		a move of everything after it.
+
+		As with DataSet, elements with the same tag stay in the order they
+		were put in.
+
+		Sequence items are still ordinary DataSets, because that's what a
+		Sequence holds.  FlatDataSets can't be decoded lazily.
+	*/
+	class FlatDataSet
+	{
+	public:
+		typedef std::pair<Tag,Value> value_type;
+		typedef std::vector<value_type> Elements;
+		typedef Elements::iterator iterator;
+		typedef Elements::const_iterator const_iterator;
+		typedef Elements::size_type size_type;
+
+		FlatDataSet(){}
+
+		//!Copies every element of data.
+		explicit FlatDataSet(const DataSet& data)
+		{
+			data.Materialize();
+			elements_.reserve(data.size());
+			for(DataSet::const_iterator I=data.begin();I!=data.end();++I)
+				elements_.push_back(value_type(I->first,I->second));
+			OffsetTable_=data.OffsetTable();
+			PixelDataSyntax_=data.PixelDataSyntax();
+		}
+
+		//!Copies every element onto a DataSet.
+		DataSet ToDataSet() const
+		{
+			DataSet data;
+			for(const_iterator I=begin();I!=end();++I)
+				data.insert(data.end(),DataSet::value_type(I->first,I->second));
+			data.SetOffsetTable(OffsetTable_);
+			data.SetPixelDataSyntax(PixelDataSyntax_);
+			return data;
+		}
+
+		//!access an element
+		/*!
+			As with DataSet, this only returns the FIRST element that
+			matches tag.
+		*/
+		const Value& operator()(const Tag tag) const
+		{
+			const_iterator element=find(tag);
+			if(element==end())
+				throw TagNotFound(tag);
+			return element->second;
+		}
+
+		//!Insert an element
+		template <VR vr, typename T>
+		void Put(Tag tag, const T& data)
+		{
+			StaticVRCheck<T,vr>();
+			insert(value_type(tag,Value(vr,data)));
+		}
+
+		//!Insert an element after any others with the same tag.
+		iterator insert(const value_type& element)
+		{
+			if(elements_.empty() || !(element.first<elements_.back().first))
+			{
+				elements_.push_back(element);
+				return elements_.end()-1;
+			}
+			return elements_.insert(upper_bound(element.first),element);
+		}
+
+		//!Get all values matching tag.
+		std::vector<Value> Values(const Tag tag) const
+		{
+			std::pair<const_iterator,const_iterator> P = equal_range(tag);
+			std::vector<Value> v;
+			for(const_iterator I=P.first;I!=P.second;I++)
+				v.push_back(I->second);
+			return v;
+		}
+
+		iterator lower_bound(Tag tag)
+		{
+			return std::lower_bound(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+		const_iterator lower_bound(Tag tag) const
+		{
+			return std::lower_bound(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+		iterator upper_bound(Tag tag)
+		{
+			return std::upper_bound(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+		const_iterator upper_bound(Tag tag) const
+		{
+			return std::upper_bound(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+		std::pair<iterator,iterator> equal_range(Tag tag)
+		{
+			return std::equal_range(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+		std::pair<const_iterator,const_iterator> equal_range(Tag tag) const
+		{
+			return std::equal_range(elements_.begin(),elements_.end(),tag,CompareTag());
+		}
+
+		iterator find(Tag tag)
+		{
+			iterator I=lower_bound(tag);
+			return (I!=end() && I->first==tag) ? I : end();
+		}
+		const_iterator find(Tag tag) const
+		{
+			const_iterator I=lower_bound(tag);
+			return (I!=end() && I->first==tag) ? I : end();
+		}
+
+		size_type count(Tag tag) const
+		{
+			std::pair<const_iterator,const_iterator> P = equal_range(tag);
+			return P.second-P.first;
+		}
+
+		//!See DataSet::OffsetTable()
+		const std::vector<UINT32>& OffsetTable() const{return OffsetTable_;}
+		void SetOffsetTable(const std::vector<UINT32>& table){OffsetTable_=table;}
+
+		//!See DataSet::PixelDataSyntax()
+		UID PixelDataSyntax() const{return PixelDataSyntax_;}
+		void SetPixelDataSyntax(const UID& transfer_syntax){PixelDataSyntax_=transfer_syntax;}
+
+		//!Remove every element matching tag.
+		size_type erase(Tag tag)
+		{
+			if(TAG_PIXEL_DATA==tag)
+			{
+				OffsetTable_.clear();
+				PixelDataSyntax_=UID();
+			}
+			std::pair<iterator,iterator> P = equal_range(tag);
+			size_type n=P.second-P.first;
+			elements_.erase(P.first,P.second);
+			return n;
+		}
+		iterator erase(iterator position)
+		{
+			return elements_.erase(position);
+		}
+
+		iterator begin(){return elements_.begin();}
+		iterator end(){return elements_.end();}
+		const_iterator begin() const{return elements_.begin();}
+		const_iterator end() const{return elements_.end();}
+		size_type size() const{return elements_.size();}
+		bool empty() const{return elements_.empty();}
+		void clear(){elements_.clear();OffsetTable_.clear();PixelDataSyntax_=UID();}
+		void reserve(size_type n){elements_.reserve(n);}
+
+		//!Nothing to do, FlatDataSets are never read lazily.  See DataSet::Materialize()
+		void Materialize() const{}
+		bool HasDeferred() const{return false;}
+
+	private:
+		struct CompareTag
+		{
+			bool operator()(const value_type& element,Tag tag) const{return element.first<tag;}
+			bool operator()(Tag tag,const value_type& element) const{return tag<element.first;}
+		};
+
+		Elements elements_;
+		std::vector<UINT32> OffsetTable_;
+		UID PixelDataSyntax_;
+	};
+
+}//namespace dicom
+
+#endif //FLAT_DATA_SET_HPP_INCLUDE_GUARD_6618204397
@@ -0,0 +1,87 @@
+#ifndef MESSAGE_ASSEMBLER_HPP_INCLUDE_GUARD_2861047395
+#define MESSAGE_ASSEMBLER_HPP_INCLUDE_GUARD_2861047395
+#include <vector>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "Types.hpp"
+#include "DataSet.hpp"
+#include "Decoder.hpp"
+
+namespace dicom
+{
+	struct ServiceBase;
+
+	namespace Implementation
+	{
+		//!Puts each incoming message together from whatever has arrived, without ever waiting for the rest.
+		/*!
+			This is how the Reactor reads, on its I/O threads, so that a worker
+			isn't taken up until there's a whole message for it to handle.
+
+			Once the association has been negotiated, P-DATA-TF PDUs are taken
+			apart as they arrive (see Part 8, tables 9-22 and 9-23), and each
+			PDV is decoded onto the command, or onto the data set after it, if
+			the command says there is one.  When the last fragment is in, both
+			are left on ServiceBase::Received_, for the handler's
+			ServiceBase::Read() calls.
+
+			Any other PDU, and anything at all before negotiation, is collected
+			whole and then put back on the socket (see Network::Socket::PutBack()),
+			so that ThreadSpecificServer reads it just as it does in thread per
+			connection mode.  Those PDUs are small, but we only take up to
+			MaxWholePDU bytes of one.
+		*/
+		class MessageAssembler : boost::noncopyable
+		{
+		public:
+			explicit MessageAssembler(ServiceBase& service);
+
+			//!Reads whatever has arrived.  Returns true once there's a message, or some other PDU, to be handled.
+			/*!
+				Throws if the connection has gone, or if the peer has sent
+				something we won't take, in which case it's been sent an
+				A-ABORT.
+			*/
+			bool ReadAvailable(bool AssociationNegotiated);
+
+			//!Have we got part of a PDU, with the rest still to come?
+			bool PartRead() const;
+
+			//!Longest PDU other than a P-DATA-TF that we'll collect.
+			static const UINT32 MaxWholePDU=1024*1024;
+
+		private:
+			bool Fill(BYTE* begin,size_t& have,size_t want);
+			bool ReadPDV();
+			bool EndOfFragments();
+			void Abort(const char* problem);
+
+			ServiceBase& service_;
+
+			enum State { PDU_HEADER, WHOLE_PDU, PDV_HEADER, PDV_DATA };
+			State state_;
+
+			//!The PDU or PDV header we're reading, and how much of it we've got.
+			BYTE header_[6];
+			size_t HeaderRead_;
+
+			//!A PDU we're collecting whole, header and all, and how much of it we've got.
+			std::vector<BYTE> whole_;
+			size_t WholeRead_;
+
+			//!What's left of the P-DATA-TF, and of the PDV, that we're reading.
+			UINT32 PDULeft_;
+			UINT32 PDVLeft_;
+			BYTE MessageHeader_;
+
+			DataSet command_;
+			DataSet data_;
+			bool ReadingDataSet_;
+
+			//!Decodes onto command_ or data_, while we're part way through one of them.
+			boost::scoped_ptr<IncrementalDecoder> decoder_;
+		};
+	}//namespace Implementation
+}//namespace dicom
+
+#endif//MESSAGE_ASSEMBLER_HPP_INCLUDE_GUARD_2861047395
@@ -0,0 +1,128 @@
+#ifndef PIXEL_DATA_HPP_INCLUDE_GUARD_4471290385
+#define PIXEL_DATA_HPP_INCLUDE_GUARD_4471290385
+#include <stdlib.h>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "DataSet.hpp"
+#include "Exceptions.hpp"
+#include "ByteCursor.hpp"
+#include "TransferSyntax.hpp"
+
+namespace dicom
+{
+	//!Number of Frames is an IS, so it's held as a string.  No attribute means a single frame.
+	/*!
+		DATA_SET is either a DataSet or a FlatDataSet.
+	*/
+	template<typename DATA_SET>
+	size_t NumberOfFrames(const DATA_SET& data)
+	{
+		std::vector<Value> values=data.Values(TAG_NUMBER_OF_FRAMES);
+		if(values.empty())
+			return 1;
+		long frames=strtol(values.front().template Get<std::string>().c_str(),0,10);
+		Enforce(frames>0,"Number of Frames must be at least one.");
+		return size_t(frames);
+	}
+
+	//!How the native pixel data of a frame is laid out, see Part 3, C.7.6.3
+	struct ImageFormat
+	{
+		size_t Rows_;
+		size_t Columns_;
+		size_t SamplesPerPixel_;
+		//!Bits Allocated / 8
+		size_t BytesPerSample_;
+		//!Planar Configuration is 1, i.e. each sample has a plane of its own, rather than being interleaved pixel by pixel.
+		bool Planar_;
+
+		//!From the Image Pixel module of data.  Throws if the samples aren't whole bytes.
+		explicit ImageFormat(const DataSet& data);
+
+		size_t Pixels() const
+		{
+			return Rows_*Columns_;
+		}
+
+		size_t FrameSize() const
+		{
+			return Pixels()*SamplesPerPixel_*BytesPerSample_;
+		}
+	};
+
+	//!Random access to the frames of a multi-frame image.
+	/*!
+		This works out where each frame of the pixel data is, without decoding
+		any of it that hasn't already been decoded.  So for a data set read with
+		DecodeOptions::Lazy_, getting a few frames out of hundreds only touches
+		the bytes of those frames.
+
+		For encapsulated (compressed) pixel data, frames are found from the
+		Extended Offset Table if the data set has one, else from the Basic
+		Offset Table (Part 5, Annex A.4, and see DataSet::OffsetTable()).  If
+		that's empty too, there has to be either one frame, or one fragment per
+		frame.
+
+		Native pixel data is split into frames of ImageFormat::FrameSize()
+		bytes each, in our byte order.
+
+		The index keeps the bytes it refers to alive, so it can outlive the
+		DataSet.
+	*/
+	class FrameIndex
+	{
+	public:
+		//!transfer_syntax is the one data was read with.
+		FrameIndex(const DataSet& data,TS transfer_syntax);
+
+		//!Number of frames.
+		size_t size() const
+		{
+			return frames_.size();
+		}
+
+		//!Is the pixel data encapsulated, i.e. is each frame compressed?
+		bool Encapsulated() const
+		{
+			return encapsulated_;
+		}
+
+		//!The fragments that make up frame n.  There's just the one for native pixel data.
+		const std::vector<ByteSpan>& Fragments(size_t n) const;
+
+		//!The bytes of frame n.
+		/*!
+			These are referred to where they are, unless the frame is split over
+			more than one fragment, in which case they're copied into scratch
+			first.  Either way the span is only good while this FrameIndex (and
+			scratch) are.
+		*/
+		ByteSpan Frame(size_t n,std::vector<BYTE>& scratch) const;
+
+	private:
+		void IndexEncapsulated(const DataSet& data,ByteSpan bytes,int ByteOrder,size_t frames);
+		void IndexFragments(const DataSet& data,size_t frames);
+		void AssignFragments(const std::vector<ByteSpan>& fragments,const std::vector<UINT64>& starts,
+			const std::vector<UINT64>& offsets,size_t frames);
+		void IndexNative(const DataSet& data,ByteSpan bytes,size_t frames);
+
+		bool encapsulated_;
+		std::vector<std::vector<ByteSpan> > frames_;
+
+		//!Whichever of these the spans point into.
+		boost::shared_ptr<const void> owner_;
+		std::vector<Value> values_;
+	};
+
+	//!Put an Extended Offset Table, and its lengths, onto data.
+	/*!
+		This is needed for frame access to encapsulated pixel data with more
+		than 4GB of fragments, which the 32 bit offsets of the Basic Offset
+		Table can't reach.  Every frame must be a single fragment (see Part 3,
+		C.7.6.3.1.8).  The Encoder leaves the Basic Offset Table empty when
+		there's one of these, as it must.
+	*/
+	void PutExtendedOffsetTable(DataSet& data,TS transfer_syntax);
+}//namespace dicom
+
+#endif //PIXEL_DATA_HPP_INCLUDE_GUARD_4471290385
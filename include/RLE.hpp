@@ -0,0 +1,36 @@
+#ifndef RLE_HPP_INCLUDE_GUARD_7730158264
+#define RLE_HPP_INCLUDE_GUARD_7730158264
+#include <vector>
+#include "Types.hpp"
+#include "ByteCursor.hpp"
+#include "PixelData.hpp"
+
+namespace dicom
+{
+	/*
+		RLE Lossless, see Part 5, Annex G.
+
+		Each frame is compressed into a single fragment.  The frame's samples
+		are split into byte planes - one per byte of each sample, most
+		significant first - and each plane is compressed with PackBits, a row
+		at a time.  A 64 byte header gives where each of these segments starts.
+		There can be at most 15, so e.g. 16 bit RGB is fine but 64 bit
+		grey isn't.
+
+		Frames are in our byte order, with samples interleaved or planar as
+		ImageFormat::Planar_ says.
+
+		This is registered as the codec for RLE_LOSSLESS_TRANSFER_SYNTAX, so
+		to compress or decompress a whole data set use Transcode(), see
+		Codec.hpp.
+	*/
+
+	//!Compresses one frame of native pixel data, of format.FrameSize() bytes, appending the fragment onto fragment.
+	void RLEEncodeFrame(const BYTE* frame,const ImageFormat& format,std::vector<BYTE>& fragment);
+
+	//!Decompresses one fragment into frame, which must have room for format.FrameSize() bytes.
+	void RLEDecodeFrame(ByteSpan fragment,const ImageFormat& format,BYTE* frame);
+
+}//namespace dicom
+
+#endif //RLE_HPP_INCLUDE_GUARD_7730158264
@@ -0,0 +1,90 @@
+#ifndef REACTOR_HPP_INCLUDE_GUARD_4471920385
+#define REACTOR_HPP_INCLUDE_GUARD_4471920385
+
+#if defined(__linux__)
+
+#include <map>
+#include <ctime>
+#include <sys/epoll.h>
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "socket/Socket.hpp"
+#include "Types.hpp"
+#include "WorkerPool.hpp"
+
+namespace dicom
+{
+	class Server;
+
+	namespace Implementation
+	{
+		struct ThreadSpecificServer;
+
+		//!Serves every association from a few I/O threads with epoll, rather than a thread each.
+		/*!
+			An association that's waiting for its next message costs no thread,
+			it just sits in the epoll set.  When something arrives on it, an I/O
+			thread reads what's there without waiting for more (see
+			MessageAssembler), and puts it back in the set until the message is
+			complete.  Then it's handed to a WorkerPool, where a worker runs the
+			handler and sends the response, just as the association's own thread
+			would in thread-per-connection mode, and then it goes back into the
+			set.  So an association is only ever being served by one thread at a
+			time, slow peers never hold up a worker, and the handlers don't need
+			to know which mode they're in.
+
+			See Server::SetEventDriven().  Only available on linux.
+		*/
+		class Reactor : boost::noncopyable
+		{
+		public:
+			//!See Server::SetLimits() for MaxQueued, and Server::SetReadTimeout() for ReadTimeout.
+			Reactor(Server& server,size_t IOThreads,size_t Workers,size_t MaxQueued,int ReadTimeout);
+
+			//!Closes any associations that are still open.
+			/*!
+				Any handler that's part way through a read of its own is
+				interrupted first, rather than waited for.
+			*/
+			~Reactor();
+
+			//!Accepts and serves connections on listener until the server's kill flag is raised.
+			void Serve(Network::ServerSocket& listener);
+
+		private:
+			void Run();
+			void Accept();
+			void Dispatch(SOCKET descriptor);
+			void Work(SOCKET descriptor);
+			void Watch(SOCKET descriptor,int operation,UINT32 events=EPOLLIN|EPOLLONESHOT);
+			void Close(SOCKET descriptor);
+			void Interrupt();
+			void SetDeadline(SOCKET descriptor,bool PartRead);
+			void Sweep();
+
+			typedef std::map<SOCKET,boost::shared_ptr<ThreadSpecificServer> > Associations;
+
+			Server& server_;
+			const size_t IOThreads_;
+			const int ReadTimeout_;
+			int epoll_;
+			Network::ServerSocket* listener_;
+
+			boost::mutex mutex_;
+			Associations associations_;
+
+			//!When associations that have stopped part way through a message get closed.  See Sweep().
+			typedef std::map<SOCKET,time_t> Deadlines;
+			Deadlines deadlines_;
+			time_t NextSweep_;
+
+			boost::scoped_ptr<WorkerPool> workers_;
+		};
+	}//namespace Implementation
+}//namespace dicom
+
+#endif//__linux__
+
+#endif//REACTOR_HPP_INCLUDE_GUARD_4471920385
@@ -23,6 +23,9 @@
 namespace dicom
 {
 	struct TerminateServerThread : public std::exception{};
+
+	//!See Server::SetReadTimeout()
+	const int DefaultReadTimeout=30;
 /*
 	The alternative to setting up all these callbacks would be to use
 	inheritance and virtual functions.
@@ -61,6 +64,11 @@ namespace dicom
 		All you need to do is to tell Server which function to call on receipt
 		of a given dicom message, using AddHandler().
 
+		Alternatively, SetEventDriven() has a few I/O threads watch every
+		connection at once, and a fixed pool of workers handle the messages,
+		see Implementation::Reactor.  That's the better choice when there are
+		many connections that are mostly idle.
+
 		This class should probably be a singleton, as I don't know what the
 		behaviour would be if you create more than one.
 
@@ -91,6 +99,31 @@ namespace dicom
 		//!When this is set to true, the Server will stop accepting new connections and eventually terminate.
 		bool KillFlag;
 
+#ifndef _WIN32
+		//!A byte is written to the second of these when the kill flag is raised, see KillFlagDescriptor()
+		int KillPipe_[2];
+#endif
+
+		//!See SetEventDriven().  No workers means a thread per connection.
+		size_t IOThreads_;
+		size_t Workers_;
+
+		//!See SetMaxPDULength()
+		UINT32 MaxPDULength_;
+
+		//!See SetReadTimeout()
+		int ReadTimeout_;
+
+		//!See SetLimits().  Zero means no limit.
+		size_t MaxAssociations_;
+		size_t MaxAssociationsPerAE_;
+		size_t MaxQueuedMessages_;
+
+		//!Associations admitted and not yet released, in all and by calling AE title.
+		boost::mutex AssociationsMutex_;
+		size_t OpenAssociations_;
+		std::map<std::string,size_t> OpenAssociationsByAE_;
+
 		/*
 			mutexes on stdout and stderr. Note that these won't help
 			if you start more than one instance of Server.  Maybe
@@ -164,6 +197,12 @@ namespace dicom
 			virtual void  AssociationNegotiated	(const primitive::AAssociateRQ& request){}
 			//!Defaults to nothing
 			virtual void AssociationTerminated	(){}
+			//!Defaults to nothing.  Called just before AssociationNegotiated(), with what we sent back.
+			/*!
+				e.g. acceptance.UserInfo_.MaxSubLength_ has our Maximum PDU Length,
+				and request.UserInfo_.MaxSubLength_ the peer's.
+			*/
+			virtual void AssociationAccepted	(const primitive::AAssociateRQ& /*request*/,const primitive::AAssociateAC& /*acceptance*/){}
 
 		}DefaultLogger_;
 
@@ -200,6 +239,7 @@ namespace dicom
 		//it's possible we should make these protected members only accesible to
 		//ThreadSpecificServer, using the friend keyword.
 		void AssociationNegotiated					(const primitive::AAssociateRQ& request);
+		void AssociationAccepted					(const primitive::AAssociateRQ& request,const primitive::AAssociateAC& acceptance);
 		void AssociationTerminated					();
 
 		bool CanHandleTransferSyntax				(primitive::TransferSyntax &);
@@ -214,6 +254,59 @@ namespace dicom
 		//!Destructor.
 		virtual ~Server();
 
+		//!Serve connections from IOThreads threads watching them all with epoll, handing messages to Workers threads.
+		/*!
+			Call this before Serve().  Handlers are then called on the worker
+			threads, so at most Workers of them run at once however many
+			associations are open.  Only available on linux, elsewhere Serve()
+			carries on with a thread per connection.
+		*/
+		void SetEventDriven(size_t IOThreads,size_t Workers);
+
+		//!The Maximum PDU Length we offer when accepting associations.  Defaults to DefaultMaxPDULength.
+		/*!
+			Any UINT32 goes, 0 meaning no limit, see Part 8, Annex D.1.  We send
+			PDUs up to the size the peer offers in turn, see ServiceBase::Write().
+		*/
+		void SetMaxPDULength(UINT32 Length);
+		UINT32 GetMaxPDULength();
+
+		//!How long, in seconds, a message that has started arriving may go quiet before we give up on it.
+		/*!
+			The association is then closed.  This stops a peer that sends
+			half a PDU from holding a thread for ever, or in event driven
+			mode its place and part read message, which is checked once a
+			second.  It's only a pause this long that counts, a
+			slow peer that keeps sending is fine however long the message
+			takes.  Idle associations waiting for their next message aren't
+			affected.  Defaults to DefaultReadTimeout, zero means no limit.
+			Call it before Serve().
+		*/
+		void SetReadTimeout(int Seconds);
+		int GetReadTimeout();
+
+		//!Limits on how much the server takes on at once.  Zero means no limit, which is the default.
+		/*!
+			Associations past MaxAssociations in all, or past MaxAssociationsPerAE
+			from any one calling AE title, are rejected with A-ASSOCIATE-RJ
+			(rejected-transient, local-limit-exceeded), so the peer knows to try
+			again later.
+
+			In event driven mode, once MaxQueuedMessages messages are waiting
+			for a worker, new associations are rejected (rejected-transient,
+			temporary-congestion).  Messages on associations that are already
+			open still join the queue, which never holds more than one per
+			association.  With a thread per connection, MaxAssociations is
+			what bounds how many handlers run at once.
+		*/
+		void SetLimits(size_t MaxAssociations,size_t MaxAssociationsPerAE,size_t MaxQueuedMessages=0);
+
+		//!Counts an association from CallingAET against the limits.  Returns false if there's no room for it.
+		bool AdmitAssociation(const std::string& CallingAET);
+
+		//!Call when an association that was admitted closes.
+		void ReleaseAssociation(const std::string& CallingAET);
+
 		//!Does not return until SIG_TERM is received.
 		void Serve(short Port);
 
@@ -232,6 +325,15 @@ namespace dicom
 		//!Has RaiseKillFlag been called
 		bool KillFlagRaised();
 
+#ifndef _WIN32
+		//!Becomes readable once the kill flag is raised, so threads can wait on it alongside their sockets.
+		/*!
+			Nothing ever reads from it, so it stays readable, and wakes every
+			thread waiting on it.
+		*/
+		int KillFlagDescriptor() const;
+#endif
+
 	};
 }//namespace dicom
 #endif //SERVER_HPP_INCLUDE_GUARD_26510884
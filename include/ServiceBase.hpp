@@ -1,7 +1,8 @@
 #ifndef SERVICE_BASE_HPP_23847239487238
 #define SERVICE_BASE_HPP_23847239487238
 #include <string>
-//#include "socket/Socket.hpp"
+#include <deque>
+#include "socket/Socket.hpp"
 #include "Buffer.hpp"
 #include "DataSet.hpp"
 #include "TransferSyntax.hpp"
@@ -12,6 +13,8 @@
 
 namespace dicom
 {
+	//!What we offer as our Maximum PDU Length unless we're told otherwise.
+	const UINT32 DefaultMaxPDULength=16384;
 
 
 	//!Thrown if connection is aborted.
@@ -48,8 +51,6 @@ namespace dicom
 
 		void WriteDataSet(const dicom::DataSet& ds, const UID& uid, TS ts = TS(IMPL_VR_LE_TRANSFER_SYNTAX)/*IMPL_VR_LE*/);
 
-		void ParseRawVRIntoDataSet(PDataTF& p_data_tf,DataSet& data,TS ts);
-
 		bool Read(DataSet& ds,TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX)/*::IMPL_VR_LE*/);
 
 		BYTE GetPresentationContextID(const UID& uid);
@@ -69,6 +70,25 @@ namespace dicom
 		//!The presentation contexts we accepted.
 		std::vector<primitive::PresentationContextAccept>	AcceptedPresentationContexts_;
 
+		//!The longest P-DATA-TF PDU we offered to take, see Part 8, Annex D.1
+		/*!
+			Strictly this is the length of the PDU's variable field, i.e. its
+			PDVs.  Any UINT32 goes, and 0 means no limit.  It only limits what
+			the peer sends, how much we send is up to PeerMaxPDULength_.
+		*/
+		UINT32 MaxPDULength_;
+
+		//!The longest P-DATA-TF PDU the peer offered to take.  0 means no limit.
+		UINT32 PeerMaxPDULength_;
+
+		//!Messages that have already been read, which Read() hands out before reading any more.
+		/*!
+			In event driven mode the Reactor reads each command, and its data
+			set, as they arrive, and leaves them here for the handler.  See
+			Implementation::MessageAssembler.
+		*/
+		std::deque<DataSet> Received_;
+
 		//!The socket on which we're communicating
 		/*!
 			Currently this pointer is managed externally to this class, which
@@ -78,7 +98,7 @@ namespace dicom
 			TODO  make a pure virtual function
 		*/
 
-        //virtual Network::Socket* GetSocket()=0;
+		virtual Network::Socket* GetSocket()=0;
 
 		//Network::Socket* socket_;
 
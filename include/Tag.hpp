@@ -229,6 +229,8 @@ namespace dicom
 
 		TAG_SAMPLES_PER_PX            = 0x00280002,
 		TAG_PHOTOMETRIC               = 0x00280004,
+		TAG_PLANAR_CONFIG             = 0x00280006,
+		TAG_NUMBER_OF_FRAMES          = 0x00280008,
 		TAG_ROWS                      = 0x00280010,
 		TAG_COLUMNS                   = 0x00280011,
 		TAG_PLANES                    = 0x00280012,
@@ -392,6 +394,8 @@ namespace dicom
 		TAG_INTERPRET_TYPE_ID         = 0x40080210,
 		TAG_INTERPRET_STATUS_ID       = 0x40080212,
 
+		TAG_EXTENDED_OFFSET_TABLE     = 0x7fe00001,
+		TAG_EXTENDED_OFFSET_TABLE_LENGTHS = 0x7fe00002,
         TAG_PIXEL_DATA                = 0x7fe00010,
 
 		TAG_DATA_SET_PADDING          = 0xfffcfffc,
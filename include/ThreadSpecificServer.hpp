@@ -1,8 +1,10 @@
 #ifndef THREAD_SPECIFIC_SERVER_HPP_INCLUDE_GUARD_32045735827708
 #define THREAD_SPECIFIC_SERVER_HPP_INCLUDE_GUARD_32045735827708
 
+#include <boost/shared_ptr.hpp>
 #include "ServiceBase.hpp"
 #include "Server.hpp"
+#include "MessageAssembler.hpp"
 
 namespace dicom
 {
@@ -35,12 +37,41 @@ namespace dicom
 			virtual Network::Socket* GetSocket(){return socket_;}
 			bool AssociationNegotiated_;
 
+			//!Has this association been counted against Server::SetLimits()?
+			bool Admitted_;
+
+			//!Only used in event driven mode, see ReadAvailable().
+			boost::shared_ptr<MessageAssembler> assembler_;
+
 			//!This gets created by the ThreadedServer framework
 			ThreadSpecificServer(Network::AcceptedSocket* socket,Server& s);
 
 			//! Thread function - gets called by newly created thread.
 			void operator()();
 
+			//!Handles whatever has arrived on the socket.  Returns false once the association is over.
+			/*!
+				This is the body of operator()'s loop, which Reactor calls directly
+				when it's serving this association instead of a thread of its own.
+			*/
+			bool HandleNextMessage();
+
+			//!Reads whatever has arrived, without waiting for more.  Returns true once HandleNextMessage() has something to do.
+			/*!
+				Reactor calls this on an I/O thread, so that its workers never
+				wait on a slow peer.  See MessageAssembler.
+			*/
+			bool ReadAvailable();
+
+			//!Is part of a message in, with the rest still to come?  See ReadAvailable().
+			bool PartRead() const;
+
+			//!Closes the socket, and gives the association's place back to the server.
+			void Close();
+
+			//!Turns down the association with an A-ASSOCIATE-RJ, as the server's too busy to take it on.  Never blocks reading.
+			void RejectAsBusy();
+
 			//!this gets called when data is available on socket.
 			void HandleData();
 
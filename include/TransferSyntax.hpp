@@ -25,6 +25,7 @@ namespace dicom
 		UID getUID() const;
 	private:
 		const UID uid_;
+		const bool encoded_;
 	};
 }//namespace dicom
 #endif //TS_HPP_INCLUDE_GUARD_48824554
@@ -20,6 +20,8 @@
 	typedef unsigned	char	UINT8;
 	typedef unsigned	short	UINT16;
 	typedef unsigned	int		UINT32;
+	typedef signed		long long	INT64;
+	typedef unsigned	long long	UINT64;
 #endif
 
 typedef UINT8 BYTE;
@@ -28,6 +30,7 @@ typedef UINT8 BYTE;
 BOOST_STATIC_ASSERT(sizeof(UINT8)==1);
 BOOST_STATIC_ASSERT(sizeof(UINT16)==2);
 BOOST_STATIC_ASSERT(sizeof(UINT32)==4);
+BOOST_STATIC_ASSERT(sizeof(UINT64)==8);
 
 
 #endif //CPP_TYPES_HPP_INCLUDE_GUARD_74749238
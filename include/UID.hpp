@@ -30,20 +30,20 @@ namespace dicom
 		UID(const std::string& s="");
 
 		//!Access underlying string representation.
-		std::string str()const;
+		const std::string& str()const;
 
 		//!So we can sort on UID
 		bool operator < (const UID& comp)const
 		{
-			return (data_  < comp.str());
+			return (data_ < comp.data_);
 		}
 		bool operator == (const UID& comp) const
 		{
-			return (data_ == comp.str());
+			return (data_ == comp.data_);
 		}
 		bool operator !=(const UID& comp) const
 		{
-			return data_!=comp.str();
+			return data_!=comp.data_;
 		}
 	private:
 		 std::string data_;
@@ -50,6 +50,9 @@ namespace dicom
 		//has to be supported if we do any lossless jpeg, see note 
 	const UID JPEG_LOSSLESS_NON_HIERARCHICAL		= UID("1.2.840.10008.1.2.4.70");
 
+	//!Run Length Encoding, lossless.  See Part 5 Annex G, and RLE.hpp
+	const UID RLE_LOSSLESS_TRANSFER_SYNTAX			= UID("1.2.840.10008.1.2.5");
+
 
 	/*
 		There are more to still go in here, mostly to do with JPEG encoding.
@@ -55,6 +55,10 @@ namespace dicom
 		VR_LO = 0x4f4c, //!< Long string
 		VR_LT = 0x544c, //!< Long Text
 		VR_OB = 0x424f, //!< Other Byte String
+		VR_OD = 0x444f, //!< Other Double String
+		VR_OF = 0x464f, //!< Other Float String
+		VR_OL = 0x4c4f, //!< Other Long String
+		VR_OV = 0x564f, //!< Other Very Long String
 		VR_OW = 0x574f, //!< Other Word String
 		VR_PN = 0x4e50, //!< Person Name
 		VR_SH = 0x4853, //!< Short String
@@ -62,12 +66,16 @@ namespace dicom
 		VR_SQ = 0x5153, //!< Sequence
 		VR_SS = 0x5353, //!< Signed Short
 		VR_ST = 0x5453, //!< Short text
+		VR_SV = 0x5653, //!< Signed Very Long
 		VR_TM = 0x4d54, //!< Time
+		VR_UC = 0x4355, //!< Unlimited Characters
 		VR_UI = 0x4955, //!< Unique Identifier
 		VR_UL = 0x4C55, //!< Unsigned Long
 		VR_UN = 0x4e55, //!< Unknown
+		VR_UR = 0x5255, //!< Universal Resource Identifier
 		VR_US = 0x5355, //!< Unsigned Short
-		VR_UT = 0x5455  //!< Unlimited Text
+		VR_UT = 0x5455, //!< Unlimited Text
+		VR_UV = 0x5655  //!< Unsigned Very Long
 		};
 
 	//!General VR mismatch, mistake etc.
@@ -151,6 +159,10 @@ namespace dicom
 	template<> struct TypeFromVR<VR_LO>{typedef	std::string					Type;	};
 	template<> struct TypeFromVR<VR_LT>{typedef	std::string					Type;	};
 	template<> struct TypeFromVR<VR_OB>{typedef	std::vector<BYTE>			Type;	};
+	template<> struct TypeFromVR<VR_OD>{typedef	std::vector<double>			Type;	};
+	template<> struct TypeFromVR<VR_OF>{typedef	std::vector<float>			Type;	};
+	template<> struct TypeFromVR<VR_OL>{typedef	std::vector<UINT32>			Type;	};
+	template<> struct TypeFromVR<VR_OV>{typedef	std::vector<UINT64>			Type;	};
 	template<> struct TypeFromVR<VR_OW>{typedef	std::vector<UINT16>			Type;	};
 	template<> struct TypeFromVR<VR_PN>{typedef	std::string					Type;	};
 	template<> struct TypeFromVR<VR_SH>{typedef	std::string					Type;	};//please replace.
@@ -162,12 +174,16 @@ namespace dicom
 	template<> struct TypeFromVR<VR_SQ>{typedef	std::vector<DataSet>		Type;	};
 
 	template<> struct TypeFromVR<VR_ST>{typedef	std::string					Type;	};
+	template<> struct TypeFromVR<VR_SV>{typedef	INT64						Type;	};
 	template<> struct TypeFromVR<VR_TM>{typedef	std::string					Type;	};//please replace.
+	template<> struct TypeFromVR<VR_UC>{typedef	std::string					Type;	};
 	template<> struct TypeFromVR<VR_UI>{typedef	UID							Type;	};
 	template<> struct TypeFromVR<VR_UL>{typedef UINT32			 			Type;	};
 	template<> struct TypeFromVR<VR_UN>{typedef	std::vector<BYTE>			Type;	};// a string of bytes, don't know what else to do with it
+	template<> struct TypeFromVR<VR_UR>{typedef	std::string					Type;	};
 	template<> struct TypeFromVR<VR_US>{typedef	UINT16						Type;	};
 	template<> struct TypeFromVR<VR_UT>{typedef	std::string					Type;	};
+	template<> struct TypeFromVR<VR_UV>{typedef	UINT64						Type;	};
 	/*
 		//are there any left?
 		.
@@ -177,6 +193,175 @@ namespace dicom
 
 
 
+	//!Every C++ type that a Value can hold, see TypeFromVR.
+	/*!
+		Several VRs share a type (all the string VRs are std::string, for
+		example), so this is what the Decoder and Encoder switch on, rather
+		than the VR itself.
+	*/
+	enum TypeIndex
+	{
+		TYPE_NONE,			//!< Not a VR we know about.
+		TYPE_STRING,
+		TYPE_UID,
+		TYPE_TAG,
+		TYPE_DATE,
+		TYPE_FLOAT,
+		TYPE_DOUBLE,
+		TYPE_INT16,
+		TYPE_UINT16,
+		TYPE_SIGNED_LONG,
+		TYPE_UINT32,
+		TYPE_INT64,
+		TYPE_UINT64,
+		TYPE_BYTES,
+		TYPE_WORDS,
+		TYPE_FLOATS,
+		TYPE_DOUBLES,
+		TYPE_LONGS,
+		TYPE_VERY_LONGS,
+		TYPE_SEQUENCE,
+		TYPE_UNSUPPORTED	//!< A C++ type that no VR maps to.
+	};
+
+	template<typename T>
+	struct TypeIndexOf
+	{
+		static const TypeIndex value=TYPE_UNSUPPORTED;
+	};
+
+	template<> struct TypeIndexOf<std::string>				{static const TypeIndex value=TYPE_STRING;};
+	template<> struct TypeIndexOf<UID>						{static const TypeIndex value=TYPE_UID;};
+	template<> struct TypeIndexOf<Tag>						{static const TypeIndex value=TYPE_TAG;};
+	template<> struct TypeIndexOf<boost::gregorian::date>	{static const TypeIndex value=TYPE_DATE;};
+	template<> struct TypeIndexOf<float>					{static const TypeIndex value=TYPE_FLOAT;};
+	template<> struct TypeIndexOf<double>					{static const TypeIndex value=TYPE_DOUBLE;};
+	template<> struct TypeIndexOf<signed short>				{static const TypeIndex value=TYPE_INT16;};
+	template<> struct TypeIndexOf<UINT16>					{static const TypeIndex value=TYPE_UINT16;};
+	template<> struct TypeIndexOf<signed long>				{static const TypeIndex value=TYPE_SIGNED_LONG;};
+	template<> struct TypeIndexOf<UINT32>					{static const TypeIndex value=TYPE_UINT32;};
+	template<> struct TypeIndexOf<INT64>					{static const TypeIndex value=TYPE_INT64;};
+	template<> struct TypeIndexOf<UINT64>					{static const TypeIndex value=TYPE_UINT64;};
+	template<> struct TypeIndexOf<std::vector<BYTE> >		{static const TypeIndex value=TYPE_BYTES;};
+	template<> struct TypeIndexOf<std::vector<UINT16> >		{static const TypeIndex value=TYPE_WORDS;};
+	template<> struct TypeIndexOf<std::vector<float> >		{static const TypeIndex value=TYPE_FLOATS;};
+	template<> struct TypeIndexOf<std::vector<double> >		{static const TypeIndex value=TYPE_DOUBLES;};
+	template<> struct TypeIndexOf<std::vector<UINT32> >		{static const TypeIndex value=TYPE_LONGS;};
+	template<> struct TypeIndexOf<std::vector<UINT64> >		{static const TypeIndex value=TYPE_VERY_LONGS;};
+	template<> struct TypeIndexOf<std::vector<DataSet> >	{static const TypeIndex value=TYPE_SEQUENCE;};
+
+	//!Everything the library needs to know about a VR, bar its name.
+	struct VRTraits
+	{
+		VR vr_;
+		TypeIndex type_;		//!< The TypeIndex of TypeFromVR<vr_>::Type
+		UINT8 size_;			//!< Size of each value in bytes, or 0 if it isn't a fixed size.
+		bool string_;			//!< Held as a std::string
+		bool LongLength_;		//!< Has a 4 byte length in explicit VR transfer syntaxes, see Part 5, section 7.1.2
+		bool multiple_;			//!< Can have more than one value, see Part 5, section 6.4
+	};
+
+	//!Fills in a VRTraits from TypeFromVR<vr>
+	template<VR vr>
+	constexpr VRTraits MakeVRTraits(bool LongLength,bool multiple)
+	{
+		typedef typename TypeFromVR<vr>::Type Type;
+		return VRTraits{vr,TypeIndexOf<Type>::value,
+			UINT8(boost::is_arithmetic<Type>::value ? sizeof(Type) : 0),
+			boost::is_same<Type,std::string>::value,LongLength,multiple};
+	}
+
+	/*!
+		Adding a VR means adding it to the enum, specialising TypeFromVR, and
+		adding a line here.
+	*/
+	struct VRTable
+	{
+		static constexpr VRTraits Entries_[]=
+		{
+			{VR(0),TYPE_NONE,0,false,false,false},//anything we don't recognise.
+			MakeVRTraits<VR_AE>(false,true),
+			MakeVRTraits<VR_AS>(false,true),
+			MakeVRTraits<VR_AT>(false,true),
+			MakeVRTraits<VR_CS>(false,true),
+			MakeVRTraits<VR_DA>(false,true),
+			MakeVRTraits<VR_DS>(false,true),
+			MakeVRTraits<VR_DT>(false,true),
+			MakeVRTraits<VR_FD>(false,true),
+			MakeVRTraits<VR_FL>(false,true),
+			MakeVRTraits<VR_IS>(false,true),
+			MakeVRTraits<VR_LO>(false,true),
+			MakeVRTraits<VR_LT>(false,false),
+			MakeVRTraits<VR_OB>(true,false),
+			MakeVRTraits<VR_OD>(true,false),
+			MakeVRTraits<VR_OF>(true,false),
+			MakeVRTraits<VR_OL>(true,false),
+			MakeVRTraits<VR_OV>(true,false),
+			MakeVRTraits<VR_OW>(true,false),
+			MakeVRTraits<VR_PN>(false,true),
+			MakeVRTraits<VR_SH>(false,true),
+			MakeVRTraits<VR_SL>(false,true),
+			MakeVRTraits<VR_SQ>(true,false),
+			MakeVRTraits<VR_SS>(false,true),
+			MakeVRTraits<VR_ST>(false,false),
+			MakeVRTraits<VR_SV>(true,true),
+			MakeVRTraits<VR_TM>(false,true),
+			MakeVRTraits<VR_UC>(true,true),
+			MakeVRTraits<VR_UI>(false,true),
+			MakeVRTraits<VR_UL>(false,true),
+			MakeVRTraits<VR_UN>(true,false),
+			MakeVRTraits<VR_UR>(true,false),
+			MakeVRTraits<VR_US>(false,true),
+			MakeVRTraits<VR_UT>(true,false),
+			MakeVRTraits<VR_UV>(true,true)
+		};
+
+		static const unsigned Size_=sizeof(Entries_)/sizeof(Entries_[0]);
+
+		/*!
+			A VR is two upper case letters, so there are 26*26 possible VRs,
+			plus one slot for everything else.
+		*/
+		static const unsigned Slots_=26*26+1;
+
+		static constexpr unsigned Slot(unsigned vr)
+		{
+			return (vr<0x10000 && (vr&0xff)-'A'<26u && (vr>>8)-'A'<26u) ?
+				((vr&0xff)-'A')*26+((vr>>8)-'A') : Slots_-1;
+		}
+
+		//!Where the VR for slot is in Entries_, or 0.
+		static constexpr UINT8 Find(unsigned slot,unsigned i=1)
+		{
+			return i==Size_ ? 0 : (Slot(Entries_[i].vr_)==slot ? UINT8(i) : Find(slot,i+1));
+		}
+
+		//!Maps Slot(vr) to an index into Entries_.
+		static const UINT8 Index_[Slots_];
+	};
+
+	//!Constant time lookup of everything we know about vr.
+	/*!
+		For a VR we don't recognise, type_ is TYPE_NONE.
+	*/
+	inline const VRTraits& GetVRTraits(VR vr)
+	{
+		return VRTable::Entries_[VRTable::Index_[VRTable::Slot(vr)]];
+	}
+
+	//!Compile time version of the above.
+	template<VR vr>
+	constexpr VRTraits StaticVRTraits()
+	{
+		return VRTable::Entries_[VRTable::Find(VRTable::Slot(vr))];
+	}
+
+	//!Does vr have a 4 byte length field in explicit VR transfer syntaxes?
+	inline bool HasLongLength(VR vr)
+	{
+		return GetVRTraits(vr).LongLength_;
+	}
+
 	//!static validation of VR <--> c++ type correspondance.
 	/*!
 		Will not compile if GIVEN_TYPE is not the correct c++ type for
@@ -189,14 +374,14 @@ namespace dicom
 		BOOST_STATIC_ASSERT((boost::is_same<EXPECTED_TYPE,typename boost::remove_const<GIVEN_TYPE>::type>::value));
 	};
 
-	//!Fails to compile if VR is one of SQ,OB,OW,or UN
+	//!Fails to compile if VR can only have one value, e.g. SQ,OB,OW,or UN
 	/*!
 		See Part 5, Section 6.4
 	*/
 	template<VR vr>
 	struct StaticMultiplicityCheck
 	{
-		BOOST_STATIC_ASSERT(vr!= VR_SQ && vr!=VR_OB && vr!=VR_OW && vr!=VR_UN && vr!=VR_UT);
+		static_assert(StaticVRTraits<vr>().multiple_,"VR can only have one value");
 	};
 
 	//!Throws BadVR if TYPE1 is not the same as TYPE2
@@ -217,110 +402,15 @@ namespace dicom
 		It is suggested to only use this when the VR cannot be
 		known at compile time (when StaticVRCheck() can be used.)
 
-
+		This is one table lookup and a comparison, see GetVRTraits()
 	*/
 	template <typename TYPE>
 	void DynamicVRCheck(VR vr) throw(BadVR)
 	{
-		switch (vr)
-		{
-		case VR_AE:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_AE>::Type>(vr);
-			break;
-		case VR_AS:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_AS>::Type>(vr);
-			break;
-		case VR_AT:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_AT>::Type>(vr);
-			break;
-		case VR_CS:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_CS>::Type>(vr);
-			break;
-		case VR_DA:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_DA>::Type>(vr);
-			break;
-		case VR_DS:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_DS>::Type>(vr);
-			break;
-		case VR_DT:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_DT>::Type>(vr);
-			break;
-		case VR_FD:
-			ThrowIfDifferent <TYPE,TypeFromVR<VR_FD>::Type>(vr);
-			break;
-		case VR_FL:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_FL>::Type> (vr);
-			break;
-		case VR_IS:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_IS>::Type>(vr);
-			break;
-		case VR_LO:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_LO>::Type>(vr);
-			break;
-		case VR_LT:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_LT>::Type>(vr);
-			break;
-		case VR_OB:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_OB>::Type>(vr);
-			break;
-		case VR_OW:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_OW>::Type>(vr);
-			break;
-		case VR_PN:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_PN>::Type>(vr);
-			break;
-		case VR_SH:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_SH>::Type>(vr);
-			break;
-		case VR_SL:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_SL>::Type> (vr);
-			break;
-
-		case VR_SQ:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_SQ>::Type> (vr);
-			break;
-		case VR_SS:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_SS>::Type> (vr);
-			break;
-		case VR_ST:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_ST>::Type>(vr);
-			break;
-		case VR_TM:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_TM>::Type>(vr);
-			break;
-		case VR_UI:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_UI>::Type>(vr);
-			break;
-		case VR_UL:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_UL>::Type>(vr);
-			break;
-		case VR_UN:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_UN>::Type>(vr);
-			break;
-		case VR_US:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_US>::Type> (vr);
-			break;
-		case VR_UT:
-			ThrowIfDifferent<TYPE,TypeFromVR<VR_UT>::Type>(vr);
-			break;
-		default:
-
+		if(GetVRTraits(vr).type_!=TypeIndexOf<TYPE>::value)
 			throw BadVR(vr);
-		}
 	}
 
-/*
-	NOTE
-	The above PATTERN (calling switch(vr) and instantiating a template
-	specialisation for each known vr) occurs at least 4 times throughout
-	the codebase.  Does this imply that we can rationalise it somehow,
-	(without making the code truly incomprehensible?)
-
-*/
-
-
-
-
 }//namespace DICOM
 
 #endif //VR_HPP_INCLUDE_GUARD_5645353874
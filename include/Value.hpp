@@ -1,23 +1,120 @@
 #ifndef VALUE_HPP_INCLUDE_GUARD_5790364856093
 #define VALUE_HPP_INCLUDE_GUARD_5790364856093
+#include <string.h>
+#include <new>
+#include <utility>
 #include "VR.hpp"
-#include "boost/any.hpp"
+#include "ByteCursor.hpp"
+#include "Arena.hpp"
 #include "boost/shared_ptr.hpp"
+#include "boost/make_shared.hpp"
+#include "boost/thread/mutex.hpp"
 
 
 namespace dicom
 {
+	//!OB or OW bytes that live somewhere else, e.g. in a memory mapped file.
+	/*!
+		Owner_ keeps Bytes_ valid.  The bytes must already be in our byte order.
+	*/
+	struct ExternalBytes
+	{
+		ByteSpan Bytes_;
+		boost::shared_ptr<const void> Owner_;
+
+		ExternalBytes(){}
+		ExternalBytes(ByteSpan bytes,const boost::shared_ptr<const void>& owner)
+			:Bytes_(bytes),Owner_(owner){}
+	};
+
+	//!What a Value built from ExternalBytes points at.
+	/*!
+		Copy_ is made the first time the data is asked for with Get(), and
+		then kept, so Values sharing this never make it twice.  The mutex is
+		only taken for that.
+	*/
+	struct ExternalStorage:ExternalBytes
+	{
+		explicit ExternalStorage(const ExternalBytes& bytes):ExternalBytes(bytes){}
+
+		mutable boost::mutex mutex_;
+		mutable boost::shared_ptr<const void> Copy_;
+	};
+
+	//!How a Value copies, moves and destroys what it's holding.
+	struct ValueStorageOps
+	{
+		void (*Copy)(void* to,const void* from);
+		void (*Move)(void* to,void* from);
+		void (*Destroy)(void* p);
+	};
+
+	/*!
+		One of these for each type a Value holds that can't just be memcpy'd.
+		Kind lets two kinds of storage share a type, see Value::external_ops().
+	*/
+	template<typename T,int Kind=0>
+	struct StorageOps
+	{
+		static void Copy(void* to,const void* from)
+		{
+			new(to) T(*static_cast<const T*>(from));
+		}
+		static void Move(void* to,void* from)
+		{
+			new(to) T(std::move(*static_cast<T*>(from)));
+		}
+		static void Destroy(void* p)
+		{
+			static_cast<T*>(p)->~T();
+		}
+		static const ValueStorageOps ops_;
+	};
+
+	template<typename T,int Kind>
+	const ValueStorageOps StorageOps<T,Kind>::ops_={&Copy,&Move,&Destroy};
+
+	//!Vectors (OB, OW, UN and SQ) can be huge, so they're kept out of line and shared.
+	template<typename T>
+	struct StoredOutOfLine:boost::false_type{};
+
+	template<typename T,typename A>
+	struct StoredOutOfLine<std::vector<T,A> >:boost::true_type{};
+
+	//!Only vectors of plain values go in an Arena.
+	/*!
+		The Arena only destroys what's in it when it goes itself, so anything
+		in there that holds on to the Arena, as a Sequence's items do, would
+		keep it alive for ever.
+	*/
+	template<typename T>
+	struct StoredInArena:boost::false_type{};
+
+	template<typename T,typename A>
+	struct StoredInArena<std::vector<T,A> >:boost::is_fundamental<T>{};
 
 	//!Represents the Value of an attribute in a data set.
 	/*!
 		See 3.5, section 7.1.
 		dicom::Value represents a DataElement, excluding the Tag.
 
-		Data is internally managed using a boost::shared_ptr.  This means
-		that copying Value objects is not expensive.  Access to the underlying
-		data is only permitted via the const Get function, and you cannot modify
-		a Value object once it has been constructed, i.e. it's immutable.  This way
-		it's safe to share references to the same underlying data.
+		Access to the underlying data is only permitted via the const Get
+		function, and you cannot modify a Value object once it has been
+		constructed, i.e. it's immutable.
+
+		Numbers, tags, dates, strings and UIDs are held inside the Value
+		itself, so they cost no allocation beyond what std::string needs
+		for a long string.  OB, OW, UN and SQ data is held out of line
+		through a boost::shared_ptr, so copying those Values stays cheap.
+		That data can come from an Arena, see DataSet.
+
+		The VR alone determines the type of the data (see TypeFromVR), so
+		DynamicVRCheck() is all the type checking that's needed.
+
+		OB and OW values can also be built from ExternalBytes, in which case no
+		copy is made until the data is first asked for with Get().  Bytes() gets
+		at the data without ever copying it.  The copy is made under a lock, so
+		a const Value can still be read from several threads at once.
 	*/
     
 	struct Value
@@ -44,12 +141,94 @@ namespace dicom
 		*/
 		template<typename T>
 		Value(VR vr,const T& data)
-			:vr_(vr)
+			:vr_(vr),ops_(0)
 		{
 			DynamicVRCheck<T>(vr);
-			data_=boost::shared_ptr<boost::any>(new boost::any(data));
+			Construct(data,boost::shared_ptr<Arena>(),StoredOutOfLine<T>());
         }
 
+		//!As above, but out of line data goes in arena if there is one, see MakeShared().
+		template<typename T>
+		Value(VR vr,const T& data,const boost::shared_ptr<Arena>& arena)
+			:vr_(vr),ops_(0)
+		{
+			DynamicVRCheck<T>(vr);
+			Construct(data,arena,StoredOutOfLine<T>());
+		}
+
+		//!Share data that somebody already has, rather than copying it.
+		/*!
+			Nobody may modify *data afterwards, because Values are immutable.
+		*/
+		template<typename T>
+		Value(VR vr,const boost::shared_ptr<T>& data)
+			:vr_(vr),ops_(0)
+		{
+			typedef typename boost::remove_const<T>::type Type;
+			DynamicVRCheck<Type>(vr);
+			if(StoredOutOfLine<Type>::value)
+				ConstructShared(data,&StorageOps<boost::shared_ptr<const void> >::ops_);
+			else
+				Construct(*data,boost::shared_ptr<Arena>(),boost::false_type());
+		}
+
+		//!Constructor for OB or OW data that we don't want to copy.
+		Value(VR vr,const ExternalBytes& data)
+			:vr_(vr),ops_(0)
+		{
+			if(vr!=VR_OB && vr!=VR_OW)
+				throw BadVR(vr);
+			ConstructShared(boost::make_shared<ExternalStorage>(data),external_ops());
+		}
+
+		Value(const Value& other)
+			:vr_(other.vr_),ops_(other.ops_)
+		{
+			if(ops_)
+				ops_->Copy(&storage_,&other.storage_);
+			else
+				storage_=other.storage_;
+		}
+
+		Value(Value&& other) noexcept
+			:vr_(other.vr_),ops_(other.ops_)
+		{
+			if(ops_)
+				ops_->Move(&storage_,&other.storage_);
+			else
+				storage_=other.storage_;
+		}
+
+		Value& operator=(const Value& other)
+		{
+			if(this!=&other)
+			{
+				Value copy(other);
+				*this=std::move(copy);
+			}
+			return *this;
+		}
+
+		Value& operator=(Value&& other) noexcept
+		{
+			if(this!=&other)
+			{
+				Destroy();
+				vr_=other.vr_;
+				ops_=other.ops_;
+				if(ops_)
+					ops_->Move(&storage_,&other.storage_);
+				else
+					storage_=other.storage_;
+			}
+			return *this;
+		}
+
+		~Value()
+		{
+			Destroy();
+		}
+
 		//could also have a Get() parametrized on VR:
 		//template<VR vr>
 		//void Get()
@@ -61,8 +240,7 @@ namespace dicom
 		template<typename T>
 		void Get(T& t) const
 		{
- 			DynamicVRCheck<T>(vr_);	//check we have the right value representation.
-			t=boost::any_cast<T>(*(data_));
+			t=Get<T>();
 		}
 
 		//!Another Get function
@@ -76,10 +254,8 @@ namespace dicom
 		template<typename T>
 		const T& Get() const
 		{
-			DynamicVRCheck<T>(vr_);
-			const boost::any& a = *data_;
-			const T* pT=boost::any_cast<T>(&a);//this form returns a pointer, see 'any' documentation.
-			return *pT;
+			DynamicVRCheck<T>(vr_);	//check we have the right value representation.
+			return Data<T>(StoredOutOfLine<T>());
 		}
 
 		//!right shift operator provided for convenience
@@ -97,11 +273,129 @@ namespace dicom
 			Get(t);
 		}
 
+		//!The raw bytes of an OB or OW value.
+		/*!
+			For a value constructed from ExternalBytes this never copies
+			anything.  The span is only valid for as long as this Value is.
+		*/
+		ByteSpan Bytes() const
+		{
+			if(IsExternal())
+				return External().Bytes_;
+			if(vr_==VR_OB)
+			{
+				const TypeFromVR<VR_OB>::Type& bytes=Get<TypeFromVR<VR_OB>::Type>();
+				const BYTE* p=bytes.empty()?0:&bytes[0];
+				return ByteSpan(p,p+bytes.size());
+			}
+			const TypeFromVR<VR_OW>::Type& words=Get<TypeFromVR<VR_OW>::Type>();
+			const BYTE* p=words.empty()?0:reinterpret_cast<const BYTE*>(&words[0]);
+			return ByteSpan(p,p+words.size()*2);
+		}
+
+		//!Does this Value refer to bytes held somewhere else?  See ExternalBytes.
+		bool IsExternal() const
+		{
+			return ops_==external_ops();
+		}
 
 	private:
-		//!The data itself, implemented using BOOST utilities.
-		boost::shared_ptr<boost::any> data_;
+		//!Big enough for any of the types we keep inline.
+		union Storage
+		{
+			double alignment_;
+			BYTE bytes_[sizeof(std::string)>sizeof(UID) ? sizeof(std::string) : sizeof(UID)];
+		};
+
+		BOOST_STATIC_ASSERT(sizeof(Storage)>=sizeof(boost::shared_ptr<const void>));
+		BOOST_STATIC_ASSERT(sizeof(Storage)>=sizeof(boost::gregorian::date));
+
+		//!Inline data
+		template<typename T>
+		void Construct(const T& data,const boost::shared_ptr<Arena>&,boost::false_type)
+		{
+			BOOST_STATIC_ASSERT(sizeof(T)<=sizeof(Storage));
+			new(&storage_) T(data);
+			if(!(boost::has_trivial_copy<T>::value && boost::has_trivial_destructor<T>::value))
+				ops_=&StorageOps<T>::ops_;
+		}
+
+		//!Out of line data
+		template<typename T>
+		void Construct(const T& data,const boost::shared_ptr<Arena>& arena,boost::true_type)
+		{
+			ConstructShared(MakeShared(StoredInArena<T>::value ? arena : boost::shared_ptr<Arena>(),data),
+				&StorageOps<boost::shared_ptr<const void> >::ops_);
+		}
+
+		void ConstructShared(const boost::shared_ptr<const void>& data,const ValueStorageOps* ops)
+		{
+			new(&storage_) boost::shared_ptr<const void>(data);
+			ops_=ops;
+		}
+
+		template<typename T>
+		const T& Data(boost::false_type) const
+		{
+			return *reinterpret_cast<const T*>(&storage_);
+		}
+
+		template<typename T>
+		const T& Data(boost::true_type) const
+		{
+			if(IsExternal())
+				return *static_cast<const T*>(Internalized().get());
+			return *static_cast<const T*>(Shared().get());
+		}
+
+		const boost::shared_ptr<const void>& Shared() const
+		{
+			return *reinterpret_cast<const boost::shared_ptr<const void>*>(&storage_);
+		}
+
+		const ExternalStorage& External() const
+		{
+			return *static_cast<const ExternalStorage*>(Shared().get());
+		}
+
+		//!A copy of the external bytes, in a vector of the type our VR calls for.
+		const boost::shared_ptr<const void>& Internalized() const
+		{
+			const ExternalStorage& external=External();
+			boost::mutex::scoped_lock lock(external.mutex_);
+			if(external.Copy_)
+				return external.Copy_;
+
+			ByteSpan bytes=external.Bytes_;
+			if(vr_==VR_OW)
+			{
+				boost::shared_ptr<TypeFromVR<VR_OW>::Type> words=
+					boost::make_shared<TypeFromVR<VR_OW>::Type>(bytes.size()/2);
+				if(!words->empty())
+					memcpy(&(*words)[0],bytes.begin(),words->size()*2);
+				external.Copy_=words;
+			}
+			else
+				external.Copy_=boost::make_shared<TypeFromVR<VR_OB>::Type>(bytes.begin(),bytes.end());
+			return external.Copy_;
+		}
+
+		void Destroy()
+		{
+			if(ops_)
+				ops_->Destroy(&storage_);
+		}
+
+		//!Marks a shared_ptr to ExternalStorage.
+		static const ValueStorageOps* external_ops()
+		{
+			return &StorageOps<boost::shared_ptr<const void>,1>::ops_;
+		}
+
+		//!Zero if storage_ can simply be copied, e.g. for numbers.
+		const ValueStorageOps* ops_;
 
+		Storage storage_;
 	};
 }
 #endif //VALUE_HPP_INCLUDE_GUARD_5790364856093
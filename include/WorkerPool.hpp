@@ -0,0 +1,57 @@
+#ifndef WORKER_POOL_HPP_INCLUDE_GUARD_6610293847
+#define WORKER_POOL_HPP_INCLUDE_GUARD_6610293847
+#include <deque>
+#include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace dicom
+{
+	namespace Implementation
+	{
+		//!A fixed number of threads, running jobs off a queue in the order they're posted.
+		/*!
+			Used by Server in event driven mode to run user handlers, so that
+			however many associations there are, only this many handlers ever run
+			at once.  The queue can be bounded too, see Post().
+		*/
+		class WorkerPool : boost::noncopyable
+		{
+		public:
+#if defined(_MSC_VER)//see comments in Cdimse.hpp for following syntax.
+			typedef boost::function0<void> Job;
+#else
+			typedef boost::function<void()> Job;
+#endif
+
+			//!MaxQueued of zero means the queue can grow without limit.
+			WorkerPool(size_t threads,size_t MaxQueued=0);
+
+			//!Runs whatever's still queued, then waits for the threads to finish.
+			~WorkerPool();
+
+			//!Queues job.  If MaxQueued jobs are already waiting, blocks until one's been taken.
+			void Post(Job job);
+
+			//!Queues job whether or not MaxQueued jobs are already waiting, for callers that mustn't block.
+			void PostNow(Job job);
+
+			//!Are MaxQueued jobs already waiting?
+			bool Saturated();
+
+		private:
+			void Run();
+
+			const size_t MaxQueued_;
+			boost::mutex mutex_;
+			boost::condition_variable ready_;
+			boost::condition_variable room_;
+			std::deque<Job> jobs_;
+			bool stopping_;
+			boost::thread_group threads_;
+		};
+	}//namespace Implementation
+}//namespace dicom
+#endif//WORKER_POOL_HPP_INCLUDE_GUARD_6610293847
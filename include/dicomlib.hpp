@@ -20,6 +20,7 @@
 */
 #include "AssociationRejection.hpp"
 #include "Cdimse.hpp"
+#include "Codec.hpp"
 #include "DataDictionary.hpp"
 #include "Dumper.hpp"
 #include "File.hpp"
@@ -23,6 +23,7 @@
 */
 namespace dicom
 {
+	class IncrementalDecoder;
 
 
 	namespace MessageControlHeader
@@ -63,6 +64,15 @@ namespace dicom
 		BYTE	PresentationContextID;
 		BYTE	MessageHeader;
 
+		//!If this is set, each fragment is decoded as it arrives rather than kept on buffer_
+		IncrementalDecoder* decoder_;
+
+		//!The longest PDU we'll take, i.e. the Maximum PDU Length we offered.  0 means no limit.
+		/*!
+			A longer one, or one whose PDVs don't add up, gets an A-ABORT.
+		*/
+		UINT32 MaxLength_;
+
 		bool	ReadDynamic(Network::Socket& socket);
 
 				PDataTF(int ByteOrder);
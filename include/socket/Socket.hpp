@@ -4,9 +4,12 @@
 #if (!defined _WIN32)
 	#include <unistd.h>
 	#include <errno.h>
+	#include <poll.h>
 	#include <sys/types.h>
 	#include <sys/socket.h>
 	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <sys/uio.h>
 	#include <netdb.h>
 	#include <unistd.h>
 	#include <arpa/inet.h>
@@ -113,32 +116,6 @@ namespace Network
 
 #ifdef _WIN32
 
-	//!	Windows doesn't support MSG_WAITALL, so we need to do a bit more work manually
-
-		/*!
-		Windows doesn't MSG_WAITALL, so recv may return before all the
-		data we asked for has been received.  To work around this, we 
-		loop until we've got all the data.
-	*/
-	inline int WindowsSafeRecv(SOCKET s,RECV_DATA_TYPE data,int BytesToRead)
-	{
-		int BytesLeftToRead=BytesToRead;
-		RECV_DATA_TYPE CurrentPointInData=data;
-		while(BytesLeftToRead!=0)
-		{
-			int BytesRead=recv(s,CurrentPointInData,BytesLeftToRead,0);
-			if(BytesRead==0)
-				throw ConnectionLost();
-			if(BytesRead==SOCKET_ERROR)
-				throw SystemError("recv",Network::GetLastError());
-			CurrentPointInData+=BytesRead;
-			BytesLeftToRead-=BytesRead;
-		}
-		return BytesToRead;
-
-	}
-
-
 	//Force MSVC 7.0 to instantiate some templated functions
 	//This is a workaround to a known bug, see http://groups.google.ca/groups?hl=en&lr=&ie=UTF-8&oe=UTF-8&threadm=4ac23acc.0301190831.34470124%40posting.google.com&rnum=20&prev=/groups%3Fq%3Dlnk1120%2Btemplate%2Bfunction%26hl%3Den%26lr%3D%26ie%3DUTF-8%26oe%3DUTF-8%26start%3D10%26sa%3DN
 
@@ -170,7 +147,7 @@ namespace Network
 	{
 	public:
 
-		Socket(int ExternalEndian=__BIG_ENDIAN):ExternalByteOrder_(ExternalEndian){}
+		Socket(int ExternalEndian=__BIG_ENDIAN):ExternalByteOrder_(ExternalEndian),PutBackRead_(0){}
 
 		const int ExternalByteOrder_;//will generally be BIG_ENDIAN, but in some dicom cases will be LITTLE_ENDIAN
 
@@ -193,23 +170,43 @@ namespace Network
 			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);
 			BOOST_STATIC_ASSERT(!::boost::is_const<T>::value);
 
-			int BytesToRead=int(count*sizeof(T));
-
-			//Read data from socket
-#ifdef __unix
-			int BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)Begin,BytesToRead,MSG_WAITALL);
+			/*
+				Read in a loop rather than with MSG_WAITALL, so that a timeout
+				(see SetReadTimeout()) is how long we go without any data,
+				rather than how long the whole read takes.  recv() takes an
+				int, so it's asked for no more than MaxRecv at a time.
+			*/
+			const size_t MaxRecv=0x40000000;
+			char* data=reinterpret_cast<char*>(Begin);
+			size_t BytesToRead=count*sizeof(T);
+			size_t BytesPutBack=TakePutBack(data,BytesToRead);
+			data+=BytesPutBack;
+			BytesToRead-=BytesPutBack;
+			while(BytesToRead)
+			{
+				int BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)data,int(std::min(BytesToRead,MaxRecv)),0);
+				if(BytesRead==0)
+					throw ConnectionLost();
+				if(BytesRead<0)
+				{
+#ifndef _WIN32
+					if(EINTR==errno)
+						continue;
+					if(EAGAIN==errno || EWOULDBLOCK==errno)
+						throw ConnectionLost("Timed out reading");
 #else
-			int BytesRead=WindowsSafeRecv(GetSocketDescriptor(),(RECV_DATA_TYPE)Begin,BytesToRead);
+					if(WSAETIMEDOUT==WSAGetLastError())
+						throw ConnectionLost("Timed out reading");
 #endif
-			//fix endian-ness - this is very slow...
-			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)>1)
-				std::transform(Begin,Begin+count,Begin,SwitchEndian<T>);
+					throw SystemError("Read Error",Network::GetLastError());
+				}
+				data+=BytesRead;
+				BytesToRead-=BytesRead;
+			}
 
-			//Check for errors.
-			if(BytesRead==0)
-				throw ConnectionLost();
-			if(BytesRead!=BytesToRead)
-				throw SystemError("Read Error",Network::GetLastError());
+			//fix endian-ness
+			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)>1)
+				SwitchEndianInPlace<sizeof(T)>(Begin,count);
 		}
 
 		//!Iterator style interface.
@@ -277,6 +274,67 @@ namespace Network
 			return (retval!=0);
 		}
 
+		//!Reads whatever has already arrived, up to length bytes, without waiting for more.
+		/*!
+			Returns how many bytes were read, which is zero if there was
+			nothing there, or -1 if the connection has gone.  No byte swapping
+			is done.
+		*/
+		int ReadAvailable(char* data,int length)
+		{
+			if(size_t BytesPutBack=TakePutBack(data,length))
+				return int(BytesPutBack);
+#ifndef _WIN32
+			int BytesRead;
+			do
+				BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)data,length,MSG_DONTWAIT);
+			while(BytesRead<0 && EINTR==errno);
+			if(BytesRead<0 && (EAGAIN==errno || EWOULDBLOCK==errno))
+				return 0;
+#else
+			if(!MoreData(0))
+				return 0;
+			int BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)data,length,0);
+#endif
+			return BytesRead>0 ? BytesRead : -1;
+		}
+
+		//!Puts length bytes back, to be read again before anything more that arrives.
+		/*!
+			For when something has been read ahead, without waiting, by code
+			that isn't going to deal with it.  See Implementation::MessageAssembler.
+		*/
+		void PutBack(const char* data,size_t length)
+		{
+			PutBack_.insert(PutBack_.end(),data,data+length);
+		}
+
+#ifndef _WIN32
+		//!Blocks until there's data to read on this socket, or until Interrupt becomes readable.
+		/*!
+			Returns true if there's data, false if it was Interrupt - which is
+			typically the read end of a pipe that gets written to when it's time
+			to stop waiting.  Unlike MoreData() this uses poll(), so there's no
+			limit on how big the descriptors can be.
+		*/
+		bool WaitForData(int Interrupt) const
+		{
+			pollfd fds[2];
+			fds[0].fd=Interrupt;
+			fds[0].events=POLLIN;
+			fds[1].fd=GetSocketDescriptor();
+			fds[1].events=POLLIN;
+			for(;;)
+			{
+				fds[0].revents=fds[1].revents=0;
+				if(poll(fds,2,-1)>=0)
+					return 0==fds[0].revents;
+				if(errno!=EINTR)
+					throw SystemError("poll.");
+			}
+		}
+#endif
+
 
 
 
@@ -297,6 +355,26 @@ namespace Network
 		}
 
 	private:
+		//!See PutBack()
+		std::vector<char> PutBack_;
+		size_t PutBackRead_;
+
+		//!Moves up to length bytes of what's been put back onto data.  Returns how many.
+		size_t TakePutBack(char* data,size_t length)
+		{
+			if(PutBack_.empty())
+				return 0;
+			length=std::min(length,PutBack_.size()-PutBackRead_);
+			memcpy(data,&PutBack_[PutBackRead_],length);
+			PutBackRead_+=length;
+			if(PutBackRead_==PutBack_.size())
+			{
+				PutBack_.clear();
+				PutBackRead_=0;
+			}
+			return length;
+		}
+
 		//!Assume endian issues already handled..
 		template <typename T>
 		void Sendn_AlreadySwapped(const T* Begin,size_t count) const
@@ -311,31 +389,131 @@ namespace Network
 				throw SystemError("send",GetLastError());
 
 		}
+
+		//!Values this big or smaller get byte swapped on the stack rather than the heap.
+		enum { SwapOnStackSize=64 };
 	public:
 		template <typename T>
 		void Sendn(const T* Begin, size_t count) const
 		{
 			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);
 
-			if(ExternalByteOrder_==__BYTE_ORDER || sizeof(T)==1)
+			if(ExternalByteOrder_==__BYTE_ORDER || sizeof(T)==1 || 0==count)
 			{
 				Sendn_AlreadySwapped(Begin,count);
 			}
 			else
 			{
-				/*
-					This is another point for potential optimization!
-					Doing heap allocations can probably be avoided in many
-					cases.
-				*/
-
-				T* data_to_send=new T[count];
-				std::transform(Begin,Begin+count,data_to_send,SwitchEndian<T>);
-				Sendn_AlreadySwapped(data_to_send,count);
-				delete[] data_to_send;
+				//Mostly this is single values, e.g. PDU header fields.
+				if(count*sizeof(T)<=SwapOnStackSize)
+				{
+					T data_to_send[SwapOnStackSize/sizeof(T)];
+					std::copy(Begin,Begin+count,data_to_send);
+					SwitchEndianInPlace<sizeof(T)>(data_to_send,count);
+					Sendn_AlreadySwapped(data_to_send,count);
+					return;
+				}
+				std::vector<T> data_to_send(Begin,Begin+count);
+				SwitchVectorEndian(data_to_send);
+				Sendn_AlreadySwapped(&data_to_send[0],count);
 			}
 		}
 
+		//!Sends Header then Data, with a single writev() where we can.
+		/*!
+			No byte swapping is done, so Header should already be in the order
+			the peer expects.  Saves a system call (and on a TCP_NODELAY socket,
+			a separate segment) per message, compared with sending each part on
+			its own.
+		*/
+		void Sendv(const unsigned char* Header,size_t HeaderLength,const unsigned char* Data,size_t DataLength) const
+		{
+#ifndef _WIN32
+			iovec parts[2];
+			parts[0].iov_base=const_cast<unsigned char*>(Header);
+			parts[0].iov_len=HeaderLength;
+			parts[1].iov_base=const_cast<unsigned char*>(Data);
+			parts[1].iov_len=DataLength;
+			iovec* part=parts;
+			int PartsLeft=DataLength ? 2 : 1;
+			while(PartsLeft)
+			{
+				ssize_t BytesSent=::writev(GetSocketDescriptor(),part,PartsLeft);
+				if(BytesSent<0 && EINTR==errno)
+					continue;
+				if(BytesSent<=0)
+					throw SystemError("writev",GetLastError());
+
+				//a signal can interrupt it part way through, so carry on from there.
+				while(PartsLeft && size_t(BytesSent)>=part->iov_len)
+				{
+					BytesSent-=part->iov_len;
+					++part;
+					--PartsLeft;
+				}
+				if(PartsLeft)
+				{
+					part->iov_base=static_cast<char*>(part->iov_base)+BytesSent;
+					part->iov_len-=BytesSent;
+				}
+			}
+#else
+			Sendn_AlreadySwapped(Header,HeaderLength);
+			if(DataLength)
+				Sendn_AlreadySwapped(Data,DataLength);
+#endif
+		}
+
+		//!Turns Nagle's algorithm off (or back on.)
+		/*!
+			With it off, whatever's sent goes straight out rather than waiting
+			for the previous segment to be acknowledged.  That suits a protocol
+			like DICOM, where each side sends a whole message then waits for the
+			reply; with it on, the tail of each message can sit waiting on the
+			peer's delayed ACK.
+
+			The socket works either way, so failure is just reported.
+		*/
+		bool SetNoDelay(bool NoDelay=true)
+		{
+			int on=NoDelay ? 1 : 0;
+			return 0==setsockopt(GetSocketDescriptor(),IPPROTO_TCP,TCP_NODELAY,(const char*)&on,sizeof(on));
+		}
+
+		//!Gives up on a read once nothing at all has arrived for Seconds, zero meaning never.
+		/*!
+			Reads normally block until everything that was asked for has
+			arrived, so a peer that stops half way through a message would
+			hold up the reading thread for good.  With this, Readn() throws
+			ConnectionLost instead.  The clock starts again whenever some data
+			arrives, so a slow peer that keeps sending is never cut off, however
+			long the read takes.  As with SetNoDelay(), failure is just
+			reported.
+		*/
+		bool SetReadTimeout(int Seconds)
+		{
+#ifndef _WIN32
+			timeval timeout;
+			timeout.tv_sec=Seconds;
+			timeout.tv_usec=0;
+#else
+			DWORD timeout=Seconds*1000;
+#endif
+			return 0==setsockopt(GetSocketDescriptor(),SOL_SOCKET,SO_RCVTIMEO,(const char*)&timeout,sizeof(timeout));
+		}
+
+		//!Holds back partial segments until Cork(false), so lots of small sends go out together.
+		/*!
+			Only does anything on linux, which has TCP_CORK.  See class Corked.
+		*/
+		void Cork(bool Corked) const
+		{
+#if defined(TCP_CORK)
+			int on=Corked ? 1 : 0;
+			setsockopt(GetSocketDescriptor(),IPPROTO_TCP,TCP_CORK,(const char*)&on,sizeof(on));
+#endif
+		}
+
 		//!Iterator - style interface.
 		/*!
 			Not sure this is a great idea, it gives the impression
@@ -383,10 +561,11 @@ namespace Network
 				Sendn_AlreadySwapped(&data[0],data.size());
 			else
 			{
-				std::vector<unsigned short> swapped_data(data);	//hopefully this is fast...
-				SwitchVectorEndian(swapped_data);				//optimized
+				std::vector<unsigned short> swapped_data(data);
+				SwitchVectorEndian(swapped_data);
 				Sendn_AlreadySwapped(&swapped_data[0],data.size());
 			}
+			return *this;
 		}
 // 		template <typename T>
 // 		const Socket& operator << (const std::vector<T>& data)const
@@ -407,6 +586,26 @@ namespace Network
 	};
 
 
+	//!Corks a socket for as long as it's in scope.
+	/*!
+		For messages that get written a field at a time, such as the
+		association PDUs, so they still go out as one segment when the
+		socket has Nagle's algorithm turned off.
+	*/
+	class Corked : public boost::noncopyable
+	{
+		const Socket& socket_;
+	public:
+		Corked(const Socket& socket):socket_(socket)
+		{
+			socket_.Cork(true);
+		}
+		~Corked()
+		{
+			socket_.Cork(false);
+		}
+	};
+
 	//!Represents a valid, OS-assigned socket.
 	/*!
 	Encapsulates a call to ::socket(), i.e. is guaranteed to represent
@@ -1,51 +1,242 @@
 #ifndef SWITCH_ENDIAN_HPP_INCLUDE_GUARD_2304875234560
 #define SWITCH_ENDIAN_HPP_INCLUDE_GUARD_2304875234560
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
 #include <boost/static_assert.hpp>
 #include <boost/type_traits.hpp>
 //!Reverses the bytes in a variable.
 /*!
-	It is possible that we could heavily optimise endian switching using
-	the swab system call.
+	Arrays of values are swapped in bulk, see SwitchEndianInPlace().
 
 	(What namespace should this be in?)
 */
 
+/*
+	May cause obscure linker errors under vc7.0, see discussion at
+	http://groups.google.ca/groups?hl=en&lr=&ie=UTF-8&oe=UTF-8&threadm=4ac23acc.0301190831.34470124%40posting.google.com&rnum=20&prev=/groups%3Fq%3Dlnk1120%2Btemplate%2Bfunction%26hl%3Den%26lr%3D%26ie%3DUTF-8%26oe%3DUTF-8%26start%3D10%26sa%3DN
+*/
 
-#ifdef _WIN32
-	typedef char SwabType;
-#else
-	typedef void SwabType;
-#endif
-
-inline
-void SwitchVectorEndian(std::vector<unsigned short>& data)
+//!Reverses the bytes at p in place.  Specialised on size so that the common cases
+//!compile down to a single bswap instruction rather than a byte-by-byte loop.
+template <int Size>
+struct ByteReverser
 {
-	BOOST_STATIC_ASSERT(sizeof(unsigned short)==2);
-
-	SwabType* p_data=reinterpret_cast <SwabType*>(&data[0]);
-
-	swab(p_data,
-		p_data,
-		static_cast<int>(data.size()*2));
-}
+	static void Reverse(unsigned char* p)
+	{
+		std::reverse(p,p+Size);
+	}
+};
 
+template <>
+struct ByteReverser<1>
+{
+	static void Reverse(unsigned char*){}
+};
 
+#if defined(__GNUC__) || defined(__clang__)
+	#define DICOMLIB_BSWAP16(x) __builtin_bswap16(x)
+	#define DICOMLIB_BSWAP32(x) __builtin_bswap32(x)
+	#define DICOMLIB_BSWAP64(x) __builtin_bswap64(x)
+#elif defined(_MSC_VER)
+	#define DICOMLIB_BSWAP16(x) _byteswap_ushort(x)
+	#define DICOMLIB_BSWAP32(x) _byteswap_ulong(x)
+	#define DICOMLIB_BSWAP64(x) _byteswap_uint64(x)
+#endif
 
+#ifdef DICOMLIB_BSWAP16
 /*
-	May cause obscure linker errors under vc7.0, see discussion at
-	http://groups.google.ca/groups?hl=en&lr=&ie=UTF-8&oe=UTF-8&threadm=4ac23acc.0301190831.34470124%40posting.google.com&rnum=20&prev=/groups%3Fq%3Dlnk1120%2Btemplate%2Bfunction%26hl%3Den%26lr%3D%26ie%3DUTF-8%26oe%3DUTF-8%26start%3D10%26sa%3DN
+	memcpy() rather than a pointer cast, because p need not be suitably
+	aligned - it's usually pointing somewhere in the middle of a byte stream.
 */
+template <>
+struct ByteReverser<2>
+{
+	static void Reverse(unsigned char* p)
+	{
+		unsigned short v;
+		memcpy(&v,p,2);
+		v=DICOMLIB_BSWAP16(v);
+		memcpy(p,&v,2);
+	}
+};
+
+template <>
+struct ByteReverser<4>
+{
+	static void Reverse(unsigned char* p)
+	{
+		unsigned int v;
+		memcpy(&v,p,4);
+		v=DICOMLIB_BSWAP32(v);
+		memcpy(p,&v,4);
+	}
+};
+
+template <>
+struct ByteReverser<8>
+{
+	static void Reverse(unsigned char* p)
+	{
+		unsigned long long v;
+		memcpy(&v,p,8);
+		v=DICOMLIB_BSWAP64(v);
+		memcpy(p,&v,8);
+	}
+};
+#endif
 
 template <typename T>
 inline T SwitchEndian(T value)
 {
 	BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);//either a float or an integral...
 	BOOST_STATIC_ASSERT(!::boost::is_const<T>::value);
-	unsigned char* b=(unsigned char*)(&value);
-	std::reverse(b,b+sizeof(T));//alternatively could use swab()
+	ByteReverser<sizeof(T)>::Reverse((unsigned char*)(&value));
 	return value;
 }
 
+/*
+	Bulk swapping of arrays, for OW pixel data, multi-valued US/FL/FD and so on.
+	We use whatever the compiler has been told the target supports:
+	AVX2 does 32 bytes at a time, SSSE3 16 bytes with a single shuffle,
+	and plain SSE2 (which every x86-64 has) 16 bytes with shifts and word
+	shuffles.  Anything left over, or everything on other platforms, goes
+	through ByteReverser one value at a time.
+*/
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define DICOMLIB_SWAP_AVX2
+	#define DICOMLIB_SWAP_SSSE3
+#elif defined(__SSSE3__)
+	#include <tmmintrin.h>
+	#define DICOMLIB_SWAP_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define DICOMLIB_SWAP_SSE2
+#endif
+
+//!Reverses the bytes of each of count Size byte values starting at p.
+template <int Size>
+struct ArrayByteReverser
+{
+	static void Reverse(unsigned char* p,size_t count)
+	{
+		for(unsigned char* end=p+count*Size;p<end;p+=Size)
+			ByteReverser<Size>::Reverse(p);
+	}
+};
+
+template <>
+struct ArrayByteReverser<1>
+{
+	static void Reverse(unsigned char*,size_t){}
+};
+
+#if defined(DICOMLIB_SWAP_SSSE3)
+
+//!pshufb control that reverses each Size byte lane.
+template <int Size> inline __m128i ByteReverseMask();
+template <> inline __m128i ByteReverseMask<2>(){return _mm_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);}
+template <> inline __m128i ByteReverseMask<4>(){return _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);}
+template <> inline __m128i ByteReverseMask<8>(){return _mm_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);}
+
+template <int Size>
+inline void ReverseVectors(unsigned char*& p,unsigned char* end)
+{
+	const __m128i mask=ByteReverseMask<Size>();
+#if defined(DICOMLIB_SWAP_AVX2)
+	const __m256i mask256=_mm256_broadcastsi128_si256(mask);
+	for(;end-p>=32;p+=32)
+	{
+		__m256i v=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p),_mm256_shuffle_epi8(v,mask256));
+	}
+#endif
+	for(;end-p>=16;p+=16)
+	{
+		__m128i v=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p),_mm_shuffle_epi8(v,mask));
+	}
+}
+
+#elif defined(DICOMLIB_SWAP_SSE2)
+
+inline __m128i ReverseWords(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+}
+
+//!Without pshufb: put the 16 bit words in the right order, then swap the bytes within them.
+template <int Size> inline __m128i ReverseVector(__m128i v);
+template <> inline __m128i ReverseVector<2>(__m128i v)
+{
+	return ReverseWords(v);
+}
+template <> inline __m128i ReverseVector<4>(__m128i v)
+{
+	v=_mm_shufflelo_epi16(v,_MM_SHUFFLE(2,3,0,1));
+	v=_mm_shufflehi_epi16(v,_MM_SHUFFLE(2,3,0,1));
+	return ReverseWords(v);
+}
+template <> inline __m128i ReverseVector<8>(__m128i v)
+{
+	v=_mm_shufflelo_epi16(v,_MM_SHUFFLE(0,1,2,3));
+	v=_mm_shufflehi_epi16(v,_MM_SHUFFLE(0,1,2,3));
+	return ReverseWords(v);
+}
+
+template <int Size>
+inline void ReverseVectors(unsigned char*& p,unsigned char* end)
+{
+	for(;end-p>=16;p+=16)
+	{
+		__m128i v=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p),ReverseVector<Size>(v));
+	}
+}
+
+#endif
+
+#if defined(DICOMLIB_SWAP_SSSE3) || defined(DICOMLIB_SWAP_SSE2)
+#define DICOMLIB_SIMD_ARRAY_REVERSER(SIZE)							\
+template <>															\
+struct ArrayByteReverser<SIZE>										\
+{																	\
+	static void Reverse(unsigned char* p,size_t count)				\
+	{																\
+		unsigned char* end=p+count*SIZE;							\
+		ReverseVectors<SIZE>(p,end);								\
+		for(;p<end;p+=SIZE)											\
+			ByteReverser<SIZE>::Reverse(p);							\
+	}																\
+};
+
+DICOMLIB_SIMD_ARRAY_REVERSER(2)
+DICOMLIB_SIMD_ARRAY_REVERSER(4)
+DICOMLIB_SIMD_ARRAY_REVERSER(8)
+#undef DICOMLIB_SIMD_ARRAY_REVERSER
+#endif
+
+//!Reverses the bytes of each of count Size byte values starting at p, in place.
+/*!
+	p needn't be aligned, so this can be used on values in the middle of a
+	byte stream.
+*/
+template <int Size>
+inline void SwitchEndianInPlace(void* p,size_t count)
+{
+	ArrayByteReverser<Size>::Reverse(static_cast<unsigned char*>(p),count);
+}
+
+template <typename T>
+inline void SwitchVectorEndian(std::vector<T>& data)
+{
+	BOOST_STATIC_ASSERT(::boost::is_arithmetic<T>::value);
+	if(!data.empty())
+		SwitchEndianInPlace<sizeof(T)>(&data[0],data.size());
+}
+
 
 
 
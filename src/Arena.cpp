@@ -0,0 +1,58 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <new>
+#include "Arena.hpp"
+
+namespace dicom
+{
+	//!Blocks don't grow any bigger than this.
+	const size_t MaxArenaBlockSize=1024*1024;
+
+	Arena::Arena(size_t FirstBlockSize)
+		:position_(0),end_(0),NextBlockSize_(FirstBlockSize),finalizers_(0)
+	{
+	}
+
+	Arena::~Arena()
+	{
+		while(finalizers_)
+		{
+			Finalizer* f=finalizers_;
+			finalizers_=f->next_;
+			f->destroy_(f);
+		}
+		for(std::vector<BYTE*>::iterator I=blocks_.begin();I!=blocks_.end();++I)
+			::operator delete(*I);
+	}
+
+	void* Arena::AllocateBlock(size_t size,size_t alignment)
+	{
+		blocks_.reserve(blocks_.size()+1);//so push_back can't throw once we've got the memory.
+
+		/*
+			Something that would take up most of a block gets a block to itself,
+			and we carry on filling the current one.
+		*/
+		if(size+alignment>NextBlockSize_/4)
+		{
+			BYTE* block=static_cast<BYTE*>(::operator new(size+alignment));
+			blocks_.push_back(block);
+			return Align(block,alignment);
+		}
+
+		BYTE* block=static_cast<BYTE*>(::operator new(NextBlockSize_));
+		blocks_.push_back(block);
+		end_=block+NextBlockSize_;
+		if(NextBlockSize_<MaxArenaBlockSize)
+			NextBlockSize_*=2;
+
+		BYTE* p=Align(block,alignment);
+		position_=p+size;
+		return p;
+	}
+}//namespace dicom
@@ -2,78 +2,39 @@
 #include <iostream>
 namespace dicom
 {
-/*
-	According to Meyers, we can optimize this by replacing
-	copy with member functions, but it's probably already
-	a memcpy underneath, right?
-*/
-/*
-
-*/
 	Buffer& Buffer::operator >> (std::vector<BYTE>& data)
 	{
-		BYTE* pData=&data.front();
-		std::copy(position(),position()+data.size(),pData);//would vector assign be faster?
-		
-		//data.assign(position(),position()+data.size());//can we profile this please?
-
-		I_+=data.size();
+		ByteCursor cursor=Cursor();
+		cursor>>data;
+		I_+=cursor.Offset();
 		return *this;
 	}
 
 	Buffer& Buffer::operator >>(std::vector<UINT16>& data)
 	{
-		UINT16* pData=&data.front();
-		BYTE* pbData=reinterpret_cast<BYTE*>(pData);
-		
-		std::copy(position(),position()+data.size()*2,pbData);//would vector::assign() be faster here?
-
-		I_+=data.size()*2;
-
-		if(ExternalByteOrder_!=__BYTE_ORDER)
-		{
-			SwitchVectorEndian(data);
-//#ifdef _WIN32
-//			swab((char*)(pbData),(char*)(pbData),data.size()*2);
-//#else
-//			swab((void*)(pbData),(void*)(pbData),data.size()*2);
-//#endif
-//			std::cout << "swapped bytes, did it work?" << std::endl;
-		}
+		ByteCursor cursor=Cursor();
+		cursor>>data;
+		I_+=cursor.Offset();
 		return *this;
 	}
+
 	Buffer& Buffer::operator >>(std::string& data)
 	{
-		for(std::string::iterator I=data.begin();I!=data.end();++I)
-			(*this)>>*I;
+		ByteCursor cursor=Cursor();
+		cursor>>data;
+		I_+=cursor.Offset();
 		return *this;
 	}
 
 	Buffer& Buffer::operator >>(Tag& tag)
 	{
-		UINT16 Group;
-		UINT16 Element;
-		*this >> Group;
-		*this >> Element;
-		tag = makeTag(Group,Element);
+		ByteCursor cursor=Cursor();
+		cursor>>tag;
+		I_+=cursor.Offset();
 		return *this;
 	}
 
 
-	Buffer& Buffer::operator <<(std::string data)
-	{
-		for(std::string::const_iterator I=data.begin();I!=data.end();++I)
-			(*this)<<*I;
-		return *this;
-	}
-
-	Buffer& Buffer::operator << (Tag tag)
-	{
-		*this << GroupTag(tag);
-		*this << ElementTag(tag);
-		return *this;
-		
-	}
 	/*
 		Really not at all happy about this.  Can we try using a deque?
 	*/
@@ -98,18 +59,14 @@ namespace dicom
 
 	void Buffer::AddVector(const std::vector<UINT16>& data)
 	{
-		if(__BYTE_ORDER==ExternalByteOrder_)
-		{
-			const BYTE* p_data=reinterpret_cast<const BYTE*> (&data[0]);
-			insert(this->end(),p_data,p_data+data.size()*2);
-		}
-		else
-		{
-			std::vector<UINT16> swapped_data(data);
-			SwitchVectorEndian(swapped_data);
-			const BYTE* p_data=reinterpret_cast<const BYTE*> (&swapped_data[0]);
-			insert(this->end(),p_data,p_data+data.size()*2);
+		if(data.empty())
+			return;
+		const BYTE* p_data=reinterpret_cast<const BYTE*> (&data[0]);
+		size_type start=size();
+		insert(this->end(),p_data,p_data+data.size()*2);
 
-		}
+		//swap in place, rather than swapping a copy and then copying that.
+		if(__BYTE_ORDER!=ExternalByteOrder_)
+			SwitchEndianInPlace<2>(&(*this)[start],data.size());
 	}
 }//namespace dicom
@@ -37,11 +37,13 @@ namespace dicom
 	ClientConnection::ClientConnection(std::string Host, unsigned short Port,
 		std::string LocalAET,std::string RemoteAET,
 		//const std::vector<PresentationContext>& ProposedPresentationContexts)
-		const PresentationContexts& ProposedPresentationContexts)
+		const PresentationContexts& ProposedPresentationContexts,
+		UINT32 MaxPDULength)
 		//: ServiceBase(new Network::ClientSocket(Host,Port))
 
 	{
 		socket_=new Network::ClientSocket(Host,Port);
+		socket_->SetNoDelay();
 
 		AAssociateRQ& association_request=AAssociateRQ_;//BAD BAD BAD
 		//AAssociateRQ association_request;
@@ -68,7 +70,8 @@ namespace dicom
 		//last bit to do is:
 		UserInformation UserInfo;
 		MaximumSubLength MaxSubLength;
-		MaxSubLength.Set(16384);	// we can do all DICOM can handle???
+		MaxPDULength_=MaxPDULength;
+		MaxSubLength.Set(MaxPDULength_);
 		UserInfo.ImpClass_.UID_=ImplementationClassUID;
 		UserInfo.ImpVersion_.Name=ImplementationVersionName;
 		UserInfo.SetMax(MaxSubLength);
@@ -154,6 +157,7 @@ namespace dicom
 	bool ClientConnection::InterogateAAssociateAC(AAssociateAC& acknowledgement)
 	{
 		AcceptedPresentationContexts_.clear();
+		PeerMaxPDULength_=acknowledgement.UserInfo_.MaxSubLength_.MaximumLength_;
 
 		std::remove_copy_if(acknowledgement.PresContextAccepts_.begin(),	//unfortunately there's no std::copy_if()
 			acknowledgement.PresContextAccepts_.end(),
@@ -0,0 +1,197 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include "Codec.hpp"
+#include "RLE.hpp"
+#include "UIDs.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		class RLECodec : public PixelCodec
+		{
+		public:
+			void EncodeFrame(const BYTE* frame,const ImageFormat& format,std::vector<BYTE>& fragment) const
+			{
+				RLEEncodeFrame(frame,format,fragment);
+			}
+			void DecodeFrame(ByteSpan fragment,const ImageFormat& format,BYTE* frame) const
+			{
+				RLEDecodeFrame(fragment,format,frame);
+			}
+		};
+
+		//!The registered codecs.
+		/*!
+			Lookups happen on every thread that decodes, so they don't take
+			the mutex.  They read a snapshot of the map, and RegisterCodec()
+			swaps in a new one rather than changing it.  The mutex just keeps
+			registrations from losing each other.
+		*/
+		struct Registry
+		{
+			typedef std::map<UID,boost::shared_ptr<const PixelCodec> > Codecs;
+
+			boost::mutex mutex_;
+			boost::shared_ptr<const Codecs> codecs_;
+
+			Registry()
+			{
+				boost::shared_ptr<Codecs> codecs(new Codecs);
+				(*codecs)[JPEG_BASELINE_TRANSFER_SYNTAX];
+				(*codecs)[JPEG_LOSSLESS_NON_HIERARCHICAL];
+				(*codecs)[RLE_LOSSLESS_TRANSFER_SYNTAX].reset(new RLECodec);
+				codecs_=codecs;
+			}
+
+			boost::shared_ptr<const Codecs> Snapshot() const
+			{
+				return boost::atomic_load(&codecs_);
+			}
+		};
+
+		/*!
+			Built the first time it's asked for, so it's there for any TS
+			constructed during static initialization.
+		*/
+		Registry& GetRegistry()
+		{
+			static Registry registry;
+			return registry;
+		}
+
+		//!Is the pixel data a single native value, rather than fragments?
+		bool IsNative(const DataSet& data)
+		{
+			const DeferredElement* deferred=data.FindDeferred(TAG_PIXEL_DATA);
+			if(deferred)
+				return UNDEFINED_LENGTH!=deferred->length_;
+			return 1==data.count(TAG_PIXEL_DATA);
+		}
+
+		boost::shared_ptr<const PixelCodec> NeedCodec(const UID& transfer_syntax)
+		{
+			boost::shared_ptr<const PixelCodec> codec=FindCodec(transfer_syntax);
+			if(!codec)
+				throw dicom::exception("No codec is registered for transfer syntax "+transfer_syntax.str());
+			return codec;
+		}
+	}
+
+	void RegisterCodec(const UID& transfer_syntax,boost::shared_ptr<const PixelCodec> codec)
+	{
+		Registry& registry=GetRegistry();
+		boost::mutex::scoped_lock lock(registry.mutex_);
+		boost::shared_ptr<Registry::Codecs> codecs(new Registry::Codecs(*registry.codecs_));
+		(*codecs)[transfer_syntax]=codec;
+		boost::atomic_store(&registry.codecs_,boost::shared_ptr<const Registry::Codecs>(codecs));
+	}
+
+	bool IsRegisteredCodec(const UID& transfer_syntax)
+	{
+		boost::shared_ptr<const Registry::Codecs> codecs=GetRegistry().Snapshot();
+		return codecs->find(transfer_syntax)!=codecs->end();
+	}
+
+	boost::shared_ptr<const PixelCodec> FindCodec(const UID& transfer_syntax)
+	{
+		boost::shared_ptr<const Registry::Codecs> codecs=GetRegistry().Snapshot();
+		Registry::Codecs::const_iterator I=codecs->find(transfer_syntax);
+		return I==codecs->end() ? boost::shared_ptr<const PixelCodec>() : I->second;
+	}
+
+	/*!
+		Fragments put in by hand, with no PixelDataSyntax(), are taken to be
+		in whatever syntax the caller is writing.
+	*/
+	bool NeedsTranscoding(const DataSet& data,TS transfer_syntax)
+	{
+		if(0==data.count(TAG_PIXEL_DATA) && !data.FindDeferred(TAG_PIXEL_DATA))
+			return false;
+		UID from=data.PixelDataSyntax();
+		if(from!=UID())
+			return from!=transfer_syntax.getUID();
+		return transfer_syntax.isEncoded() && FindCodec(transfer_syntax.getUID()) && IsNative(data);
+	}
+
+	/*!
+		Decompressed pixel data is OB for 8 bit samples and OW for anything
+		bigger.  Compressed pixel data is one fragment per frame, so the Encoder
+		can work out the offset table.
+	*/
+	void Transcode(DataSet& data,TS transfer_syntax)
+	{
+		if(!NeedsTranscoding(data,transfer_syntax))
+			return;
+
+		UID from=data.PixelDataSyntax();
+		boost::shared_ptr<const PixelCodec> decoder,encoder;
+		if(from!=UID())
+			decoder=NeedCodec(from);
+		if(transfer_syntax.isEncoded())
+			encoder=NeedCodec(transfer_syntax.getUID());
+
+		ImageFormat format(data);
+		size_t FrameSize=format.FrameSize();
+		std::vector<BYTE> bytes;
+		std::vector<UINT16> words;
+		std::vector<std::vector<BYTE> > fragments;
+		{
+			FrameIndex index(data,TS(from==UID() ? EXPL_VR_LE_TRANSFER_SYNTAX : from));
+
+			//frames are decoded straight into the native pixel data if that's where they're going.
+			BYTE* pixels=0;
+			if(!encoder && 1==format.BytesPerSample_)
+			{
+				bytes.resize(FrameSize*index.size());
+				pixels=bytes.empty() ? 0 : &bytes[0];
+			}
+			else if(!encoder)
+			{
+				words.resize((FrameSize*index.size()+1)/2);
+				pixels=words.empty() ? 0 : reinterpret_cast<BYTE*>(&words[0]);
+			}
+			else
+				fragments.resize(index.size());
+
+			std::vector<BYTE> scratch,frame;
+			for(size_t i=0;i<index.size();i++)
+			{
+				ByteSpan compressed=index.Frame(i,scratch);
+				if(!encoder)
+				{
+					decoder->DecodeFrame(compressed,format,pixels+i*FrameSize);
+					continue;
+				}
+				const BYTE* native=compressed.begin();
+				if(decoder)
+				{
+					frame.resize(FrameSize);
+					decoder->DecodeFrame(compressed,format,frame.empty() ? 0 : &frame[0]);
+					native=frame.empty() ? 0 : &frame[0];
+				}
+				encoder->EncodeFrame(native,format,fragments[i]);
+			}
+		}
+
+		data.erase(TAG_PIXEL_DATA);
+		if(encoder)
+		{
+			for(std::vector<std::vector<BYTE> >::const_iterator I=fragments.begin();I!=fragments.end();++I)
+				data.Put<VR_OB>(TAG_PIXEL_DATA,*I);
+			data.SetPixelDataSyntax(transfer_syntax.getUID());
+		}
+		else if(1==format.BytesPerSample_)
+			data.Put<VR_OB>(TAG_PIXEL_DATA,bytes);
+		else
+			data.Put<VR_OW>(TAG_PIXEL_DATA,words);
+	}
+}//namespace dicom
@@ -542,8 +542,8 @@ namespace dicom
 			{0x00280000,VR_UL,"GroupLength"},
 			{TAG_SAMPLES_PER_PX,VR_US,"SamplesperPixel"},
 			{TAG_PHOTOMETRIC,VR_CS,"PhotometricInterpretation"},
-			{0x00280006,VR_US,"PlanarConfiguration"},
-			{0x00280008,VR_IS,"NumberofFrames"},
+			{TAG_PLANAR_CONFIG,VR_US,"PlanarConfiguration"},
+			{TAG_NUMBER_OF_FRAMES,VR_IS,"NumberofFrames"},
 			{0x00280009,VR_AT,"FrameIncrementPointer"},
 			{TAG_ROWS,VR_US,"Rows"},
 			{TAG_COLUMNS,VR_US,"Columns"},
@@ -1332,6 +1332,8 @@ namespace dicom
 			{0x40080300,VR_ST,"Impressions"},
 			{0x40084000,VR_ST,"ResultsComments"},
 			{0x7FE00000,VR_UL,"GroupLength"},
+			{TAG_EXTENDED_OFFSET_TABLE,VR_OV,"ExtendedOffsetTable"},
+			{TAG_EXTENDED_OFFSET_TABLE_LENGTHS,VR_OV,"ExtendedOffsetTableLengths"},
 
 			//note that the following is dependant on the transfer syntax.
 			//See Part 5, Annex A
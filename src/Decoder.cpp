@@ -6,6 +6,7 @@
 *	See LICENSE.txt for copyright and licensing info.
 *************************************************************************/
 #include <iostream>
+#include <algorithm>
 #include <boost/static_assert.hpp>
 #include <boost/type_traits.hpp>
 
@@ -20,6 +21,8 @@
 #include "Exceptions.hpp"
 #include "DataDictionary.hpp"
 #include "ValueToStream.hpp"
+#include "Deflate.hpp"
+#include "Codec.hpp"
 
 
 #include "Dumper.hpp"
@@ -28,12 +31,28 @@ using namespace std;
 
 namespace dicom{
 
-	struct Decoder
+	//!Decodes onto a DATA_SET, which is either a DataSet or a FlatDataSet.
+	/*!
+		Sequence items always go onto DataSets, because that's what a Sequence holds.
+	*/
+	template<typename DATA_SET>
+	struct BasicDecoder
 	{
 		void Decode();
         bool DecodeElement();
 
-		Decoder(Buffer& buffer,DataSet& ds,TS ts):buffer_(buffer),dataset_(ds),ts_(ts){}
+		//!If bulk_owner is set, OB and OW values refer into buffer, see DecodeOptions::ReferenceBulkData_
+		BasicDecoder(ByteCursor& buffer,DATA_SET& ds,TS ts,
+			const boost::shared_ptr<const void>& bulk_owner=boost::shared_ptr<const void>())
+			:buffer_(buffer),dataset_(ds),ts_(ts),options_(0),bulk_owner_(bulk_owner){}
+
+		//!For top level data sets only.  If source is set we only index elements, see DecodeOptions::Lazy_
+		BasicDecoder(ByteCursor& buffer,DATA_SET& ds,TS ts,const DecodeOptions* options,
+			const boost::shared_ptr<const DeferredSource>& source,
+			const boost::shared_ptr<const void>& bulk_owner)
+			:buffer_(buffer),dataset_(ds),ts_(ts),options_(options),source_(source),bulk_owner_(bulk_owner){}
+
+		void DecodeValue(Tag tag, VR vr, UINT32 length);
 
 		//!see 5/7.5.2
 		struct EndOfSequence{};
@@ -41,59 +60,130 @@ namespace dicom{
 
 		void DecodeVRAndLength(Tag tag, VR& vr, UINT32& length);
 
-		Buffer& buffer_;
-		DataSet& dataset_;
+		ByteCursor& buffer_;
+		DATA_SET& dataset_;
 		TS ts_;
 
+		//!Only set when decoding a top level data set.
+		const DecodeOptions* options_;
+
+		//!Set if we're only indexing elements, see DecodeOptions::Lazy_
+		boost::shared_ptr<const DeferredSource> source_;
+
+		//!Keeps buffer_ alive, if OB and OW values are allowed to refer into it.
+		boost::shared_ptr<const void> bulk_owner_;
+
+		//!Can we leave an OB or OW value where it is, rather than copying it?
+		bool CanReference(VR vr) const
+		{
+			return bulk_owner_.get()!=0 && (VR_OB==vr || buffer_.ExternalByteOrder_==__BYTE_ORDER);
+		}
+
+		void PutReference(Tag tag, VR vr, ByteSpan bytes)
+		{
+			dataset_.insert(typename DATA_SET::value_type(tag,Value(vr,ExternalBytes(bytes,bulk_owner_))));
+		}
+
+		//!The Value takes the sequence over, rather than copying it.
+		void PutSequence(Tag tag, const boost::shared_ptr<Sequence>& sequence)
+		{
+			dataset_.insert(typename DATA_SET::value_type(tag,Value(VR_SQ,sequence)));
+		}
+
 		void DecodeSequence(Tag tag, UINT32  length);
 
-		/*!
-			Extract one element onto dataset.
-		*/
-		template <VR vr>
-		void GetElementValue(Tag tag)
+		void Defer(Tag tag, VR vr, UINT32 length);
+
+		static void AddDeferred(DataSet& ds, Tag tag, const DeferredElement& element,
+			const boost::shared_ptr<const DeferredSource>& source)
 		{
-			typename TypeFromVR<vr>::Type data;
+			ds.Deferred_.insert(DataSet::DeferredElements::value_type(tag,element));
+			ds.Source_=source;
+		}
 
-			buffer_>>data;
+		static void AddDeferred(FlatDataSet&, Tag, const DeferredElement&,
+			const boost::shared_ptr<const DeferredSource>&)
+		{
+			throw DecoderError("FlatDataSet can't be decoded lazily.");
+		}
+
+		static boost::shared_ptr<Arena> ArenaOf(const DataSet& ds)
+		{
+			return ds.GetArena();
+		}
 
-			//the 'template' keyword in the following line is technically redundant
-			//but works round a known bug in gcc.
-			//See http://gcc.gnu.org/cgi-bin/gnatsweb.pl?cmd=view%20audit-trail&database=gcc&pr=9510
-			dataset_.template Put<vr>(tag,data);
+		static boost::shared_ptr<Arena> ArenaOf(const FlatDataSet&)
+		{
+			return boost::shared_ptr<Arena>();
+		}
+		void SkipUndefinedLength();
+		void SkipItem();
 
+		//!Puts a value whose VR we only know at run time.
+		template<typename T>
+		void Put(Tag tag, VR vr, const T& data)
+		{
+			dataset_.insert(typename DATA_SET::value_type(tag,Value(vr,data,ArenaOf(dataset_))));
 		}
 
 		/*!
-			Only use previous function directly if we're sure that multiplicity is 1.
-			(ie. if VR is one of SQ,OB,OW,or UN).  Otherwise use this function, which
-			takes multiplicity into account.
+			Extract one or more fixed size values onto dataset, e.g. US, FD, SL.
+			Each value becomes an element of its own.  The values are read
+			(and byte swapped) a chunk at a time rather than one by one.
 		*/
-		template <VR vr>
-		void GetElementValue(Tag tag, size_t length)
+		template <typename T>
+		void DecodeNumbers(Tag tag, VR vr, size_t length)
 		{
-			StaticMultiplicityCheck<vr>();
-			typedef typename TypeFromVR<vr>::Type DataType;
+			const size_t ChunkSize=64;
+			T chunk[ChunkSize];
 
-			Buffer::iterator end = buffer_.position()+length;
-			while(buffer_.position()!=end)
-				GetElementValue<vr>(tag);
+			size_t count=length/sizeof(T);
+			while(count>0)
+			{
+				size_t n=std::min(count,ChunkSize);
+				buffer_.Read(chunk,n);
+				for(size_t i=0;i<n;i++)
+					Put(tag,vr,chunk[i]);
+				count-=n;
+			}
+			buffer_.Increment(length%sizeof(T));//shouldn't happen, but stay in step if it does.
 		}
 
-		
+		//!AT values are a pair of 16 bit numbers, not one 32 bit one.
+		void DecodeTags(Tag tag, size_t length)
+		{
+			const BYTE* end = buffer_.position()+length;
+			while(buffer_.position()<end)
+			{
+				Tag data;
+				buffer_>>data;
+				Put(tag,VR_AT,data);
+			}
+		}
+
+		//!OW, OF, OD, OL and OV, which are vectors of numbers.
+		template <typename T>
+		void DecodeVector(Tag tag, VR vr, size_t length)
+		{
+			if(VR_OW==vr && CanReference(VR_OW))
+			{
+				PutReference(tag,VR_OW,buffer_.Take(length));
+				return;
+			}
+			std::vector<T> data(length/sizeof(T),0);
+			buffer_>>data;
+			Put(tag,vr,data);
+		}
 
 		/*!
-			slightly different than above, as string multiplicity is handled differently than
-			other types, using a backslash as a seperator.
+			String multiplicity is handled differently than
+			other types, using a backslash as a seperator.  VRs that can
+			only have one value (see VRTraits::multiple_) keep any backslashes.
 		*/
-
-		template <VR vr>
-		void DecodeString(Tag tag, size_t length)
+		void DecodeString(Tag tag, VR vr, size_t length, bool multiple)
 		{
-			BOOST_STATIC_ASSERT((boost::is_same<std::string,typename TypeFromVR<vr>::Type>::value));
-
-			string s(length,' ');
-			buffer_>>s;
+			ByteSpan span=buffer_.Take(length);
+			string s(span.begin(),span.end());
 
 			StripTrailingWhitespace(s);
 			
@@ -103,6 +193,12 @@ namespace dicom{
 			*/
 			StripTrailingNull(s);
 
+			if(!multiple)
+			{
+				Put(tag,vr,s);
+				return;
+			}
+
 			//	parse multiplicity using boost::tokenizer
 
 			typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
@@ -110,13 +206,15 @@ namespace dicom{
 			tokenizer tokens(s, sep);
 
 			for (tokenizer::iterator tok_iter = tokens.begin();tok_iter != tokens.end(); ++tok_iter)
-				dataset_.template Put<vr>(tag,*tok_iter);
+				Put(tag,vr,*tok_iter);
 		}
 
+		void DecodeDate(Tag tag, size_t length);
+
 		void DecodeUID(Tag tag, size_t length)
 		{
-			string s(length, ' ');
-			buffer_ >> s;
+			ByteSpan span=buffer_.Take(length);
+			string s(span.begin(),span.end());
 			StripTrailingNull(s);
 
 			/*
@@ -148,10 +246,8 @@ namespace dicom{
 					-tag should be 'Pixel Data'
 					-Data is encapsulated as shown in Part5, Table A.4-2
 
-					I think we could handle this by treating the fragments as multiple values
-					for this tag.  We could throw away the offset table, sacrificing potential
-					speed gains for simplicity, but this might upset clients that expect
-					it to be persisted?
+					The fragments are treated as multiple values for this tag.  The
+					offset table is kept on the data set, see DataSet::OffsetTable()
 				*/
 				Enforce(ts_.isEncoded(),"Undefined value length on non-encoded transfer syntax.");
 
@@ -161,7 +257,12 @@ namespace dicom{
 				Enforce(TAG_ITEM==offset_table_tag,"Offset table must be defined in encoded data");
 				UINT32 length;
 				buffer_ >> length;
-				buffer_.Increment(length);//we ignore the offset table...
+				Enforce(0==length%4,"Offset table entries are 4 bytes each.");
+				std::vector<UINT32> offsets(length/4);
+				for(std::vector<UINT32>::iterator I=offsets.begin();I!=offsets.end();++I)
+					buffer_ >> *I;
+				dataset_.SetOffsetTable(offsets);
+				dataset_.SetPixelDataSyntax(ts_.getUID());
 
 				for(;;)
 				{
@@ -172,16 +273,26 @@ namespace dicom{
 					if(TAG_SEQ_DELIM_ITEM==tag)
 						break;
 					Enforce(TAG_ITEM==tag,"Tag must be sequence item");
-					TypeFromVR<VR_OB>::Type data(length,0);
-					buffer_>>data;
-					dataset_.Put<VR_OB>(TAG_PIXEL_DATA,data);
+					ByteSpan span=buffer_.Take(length);
+					if(CanReference(VR_OB))
+						PutReference(TAG_PIXEL_DATA,VR_OB,span);
+					else
+					{
+						TypeFromVR<VR_OB>::Type data(span.begin(),span.end());
+						dataset_.template Put<VR_OB>(TAG_PIXEL_DATA,data);
+					}
 				}
 			}
 			else
 			{
-				TypeFromVR<VR_OB>::Type data(length,0);
-				buffer_>>data;
-				dataset_.Put<VR_OB>(tag,data);
+				ByteSpan span=buffer_.Take(length);
+				if(CanReference(VR_OB))
+					PutReference(tag,VR_OB,span);
+				else
+				{
+					TypeFromVR<VR_OB>::Type data(span.begin(),span.end());
+					dataset_.template Put<VR_OB>(tag,data);
+				}
 			}
 		}
 
@@ -190,6 +301,8 @@ namespace dicom{
 
 
 
+	typedef BasicDecoder<DataSet> Decoder;
+
 	//!DICOM messages need to have even byte length.(Part 5 section 7.1)
 	void CheckEven(int ByteLength)throw (exception)
 	{
@@ -199,7 +312,8 @@ namespace dicom{
 
 
 
-	void Decoder::DecodeVRAndLength(Tag tag, VR& vr, UINT32& length)
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::DecodeVRAndLength(Tag tag, VR& vr, UINT32& length)
 	{
 		if(ts_.isExplicitVR())		//then get VR from stream
 		{
@@ -208,7 +322,7 @@ namespace dicom{
 
 			vr=VR(w);
 
-			if (vr == VR_UN || vr == VR_SQ || vr == VR_OW || vr == VR_OB || vr == VR_UT)//see Part5 / 7.1.2
+			if (HasLongLength(vr))//see Part5 / 7.1.2
 			{
 				buffer_ >> w;		//	2 bytes unused
 				buffer_>>length;	//4 bytes of length info
@@ -231,7 +345,8 @@ namespace dicom{
 	/*!
 		This is described in Part 5, section 7.1
 	*/
-    bool Decoder::DecodeElement()
+	template<typename DATA_SET>
+	bool BasicDecoder<DATA_SET>::DecodeElement()
 	{
 		Tag tag;
 		buffer_ >> tag;
@@ -247,11 +362,23 @@ namespace dicom{
 									//this kind of situation, as it's not really 'unexpected'.
 		}
 
+		if(options_ && options_->PastEnd(tag))
+			return false;
+
 		VR vr;
 		UINT32 length;
 
 		DecodeVRAndLength(tag,vr,length);
 
+		if(options_ && !options_->Wanted(tag))
+		{
+			if(UNDEFINED_LENGTH==length)
+				SkipUndefinedLength();
+			else
+				buffer_.Increment(length);
+			return true;
+		}
+
 		if(tag==TAG_NULL)
 		{
 			cout<< "null tag, length=" << length << endl;
@@ -259,12 +386,26 @@ namespace dicom{
 			//I think this gets sent at the beginning of a DICOM message.  TODO
 		}
 
+		if(source_)
+			Defer(tag,vr,length);
+		else
+			DecodeValue(tag,vr,length);
+		return true;
+	}
+
+	/*!
+		Reads the value of an element whose header has already been read,
+		and pushes it onto the data set.
+	*/
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::DecodeValue(Tag tag, VR vr, UINT32 length)
+	{
 
 		if (vr == VR_SQ || (vr==VR_UN && length == UNDEFINED_LENGTH))//See Part 5, section 6.2.2, Notes 4
 		//if (vr == VR_SQ)//is this correct?
         {
             DecodeSequence(tag,length);
-            return true;
+            return;
 		}
 
         if(UNDEFINED_LENGTH!=length){
@@ -274,18 +415,15 @@ namespace dicom{
 
 		if(TAG_DATA_SET_PADDING==tag)
         {//throw away padding - we don't maintain it.
-			vector<unsigned char> dummy(length);
-            buffer_>>dummy;
-            return true;
+            buffer_.Increment(length);
+            return;
 		}
 
-		/*
-			use the 'switch' statement to explicitly instantiate instances
-			of GetElementValue templated on required VR.
-		*/
 		/*
 			Now we read the relevant data from the byte stream, transfrom it
-			to the correct C++ type and push it onto the data set.
+			to the correct C++ type and push it onto the data set.  VRs that
+			share a C++ type are decoded the same way, so we switch on the
+			type rather than on the VR, see VRTraits.
 		*/
 
 		/*
@@ -294,141 +432,179 @@ namespace dicom{
 			that, and letting the end user sort it out.
 		*/
 
-		switch(vr)
+		const VRTraits& traits=GetVRTraits(vr);
+		switch(traits.type_)
 		{
-
-		case VR_AT://attribute tag??
-        {	 GetElementValue<VR_AT>(tag,length); return true;}
-		case VR_US://Unsigned Short
-        {	 GetElementValue<VR_US>(tag,length); return true;}
-		case VR_SS://signed short
-        {	 GetElementValue<VR_SS>(tag,length); return true;}
-		case VR_OB://other byte string
-        {	 DecodeOB(tag,length); return true;}
-		case VR_OW://other word string
-			{
-				TypeFromVR<VR_OW>::Type data((length>>1),0);// divide length by 2 because this is an array of
-															// two-byte characters, and 'length' is the number
-															// of bytes.
-				buffer_>>data;
-				dataset_.Put<VR_OW>(tag,data);
-			}
-			break;
-		case VR_UL://unsigned long
-        {	GetElementValue<VR_UL>(tag,length); return true;}
-		case VR_SL://signed long
-        {	GetElementValue<VR_SL>(tag,length); return true;}
-		case VR_FL://float
-        {	GetElementValue<VR_FL>(tag,length); return true;}
-		case VR_FD://double
-        {	GetElementValue<VR_FD>(tag,length); return true;}
-		case VR_UI://unique identifier.
-        {	DecodeUID(tag,length); return true;}
-		case VR_DA://date, 8 bytes fixed date format.
-			{//Multiplicity!!!
-				/*if(length!=8)
-					throw DecoderError("Date must be 8 bytes long.");*/
-				string s(length,' ');
-				buffer_>>s;
-
-				StripTrailingWhitespace(s);
-
-				//	parse multiplicity using boost::tokenizer
-
-				typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-				boost::char_separator<char> sep("\\","",boost::keep_empty_tokens);//strings are seperated by backslashes;
-				tokenizer tokens(s, sep);
-
-				for (tokenizer::iterator tok_iter = tokens.begin();tok_iter != tokens.end(); ++tok_iter)
-				{
-					try
-					{
-						boost::gregorian::date d(boost::gregorian::from_undelimited_string(*tok_iter));
-						dataset_.template Put<VR_DA>(tag,d);
-					}
-					catch(std::out_of_range& e)
-					{	//currently, if we have a bad date then we 
-						//just don't put it onto the data set.  I'm
-						//not sure whether this is the best thing to do 
-						//or not.
-						cerr << "Bad date: " << *tok_iter;						
-					}
-				}
-
-			}
-			break;
-		case VR_UN:
+		case TYPE_STRING:
+			return DecodeString(tag,vr,length,traits.multiple_);
+		case TYPE_UID:
+			return DecodeUID(tag,length);
+		case TYPE_DATE:
+			return DecodeDate(tag,length);
+		case TYPE_TAG:
+			return DecodeTags(tag,length);
+		case TYPE_FLOAT:
+			return DecodeNumbers<float>(tag,vr,length);
+		case TYPE_DOUBLE:
+			return DecodeNumbers<double>(tag,vr,length);
+		case TYPE_INT16:
+			return DecodeNumbers<signed short>(tag,vr,length);
+		case TYPE_UINT16:
+			return DecodeNumbers<UINT16>(tag,vr,length);
+		case TYPE_SIGNED_LONG:
+			return DecodeNumbers<signed long>(tag,vr,length);
+		case TYPE_UINT32:
+			return DecodeNumbers<UINT32>(tag,vr,length);
+		case TYPE_INT64:
+			return DecodeNumbers<INT64>(tag,vr,length);
+		case TYPE_UINT64:
+			return DecodeNumbers<UINT64>(tag,vr,length);
+		case TYPE_BYTES:
+			if(VR_OB==vr)
+				return DecodeOB(tag,length);
 			{
-				vector <BYTE> v (length);
-				buffer_>>v;
-				dataset_.Put<VR_UN>(tag,v);
+				ByteSpan span=buffer_.Take(length);
+				vector <BYTE> v (span.begin(),span.end());
+				return Put(tag,vr,v);
 			}
-			break;
-
-
-			//all the string types!
-			//(This list will get shorter as we introduce more intelligent types for
-			// some VR's, e.g. a proper Date type,)
-		case VR_AS:
-        {	 DecodeString<VR_AS>(tag,length); return true;}
-		case VR_CS:
-        {	 DecodeString<VR_CS>(tag,length); return true;}
-		case VR_DS:
-        {	 DecodeString<VR_DS>(tag,length); return true;}
-		case VR_DT:
-        {	 DecodeString<VR_DT>(tag,length); return true;}//really should be a datetime object!!
-		case VR_LO:
-        {	 DecodeString<VR_LO>(tag,length); return true;}
-		case VR_LT:
-        {	 DecodeString<VR_LT>(tag,length); return true;}
-		case VR_PN:
-        {	 DecodeString<VR_PN>(tag,length); return true;}
-		case VR_SH:
-        {	 DecodeString<VR_SH>(tag,length); return true;}
-		case VR_ST:
-        {	 DecodeString<VR_ST>(tag,length); return true;}
-		case VR_TM:
-        {	 DecodeString<VR_TM>(tag,length); return true;}
-		case VR_UT://unlimited text.  Cannot be multivalued.
-			{
-
-				string s(length,' ');
-				buffer_>>s;
-				StripTrailingWhitespace(s);
-				dataset_.template Put<VR_UT>(tag,s);
-
-			}
-			break;
-		case VR_IS:
-        {	DecodeString<VR_IS>(tag,length); return true;}
-		case VR_AE:
-        {   DecodeString<VR_AE>(tag,length); return true;}
+		case TYPE_WORDS:
+			return DecodeVector<UINT16>(tag,vr,length);
+		case TYPE_FLOATS:
+			return DecodeVector<float>(tag,vr,length);
+		case TYPE_DOUBLES:
+			return DecodeVector<double>(tag,vr,length);
+		case TYPE_LONGS:
+			return DecodeVector<UINT32>(tag,vr,length);
+		case TYPE_VERY_LONGS:
+			return DecodeVector<UINT64>(tag,vr,length);
 		default:
 			cout << "Unknown VR: " << UINT32(vr) << " in DecodeElement()" << endl;
             cout << "Tag is: " << UINT32(tag) << "  dataset size is " << dataset_.size() << endl;
 			throw UnknownVR(vr);
         }
+	}
+
+	//!DA, which is 8 bytes fixed date format.
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::DecodeDate(Tag tag, size_t length)
+	{
+		//Multiplicity!!!
+		/*if(length!=8)
+			throw DecoderError("Date must be 8 bytes long.");*/
+		ByteSpan span=buffer_.Take(length);
+		string s(span.begin(),span.end());
+
+		StripTrailingWhitespace(s);
 
-        return true;
+		//	parse multiplicity using boost::tokenizer
+
+		typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+		boost::char_separator<char> sep("\\","",boost::keep_empty_tokens);//strings are seperated by backslashes;
+		tokenizer tokens(s, sep);
+
+		for (tokenizer::iterator tok_iter = tokens.begin();tok_iter != tokens.end(); ++tok_iter)
+		{
+			try
+			{
+				boost::gregorian::date d(boost::gregorian::from_undelimited_string(*tok_iter));
+				Put(tag,VR_DA,d);
+			}
+			catch(std::out_of_range& e)
+			{	//currently, if we have a bad date then we 
+				//just don't put it onto the data set.  I'm
+				//not sure whether this is the best thing to do 
+				//or not.
+				cerr << "Bad date: " << *tok_iter;						
+			}
+		}
 	}
 
 
+	/*!
+		Records where an element's value is, and steps over it without decoding it.
+	*/
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::Defer(Tag tag, VR vr, UINT32 length)
+	{
+		const BYTE* begin=buffer_.position();
+		if(UNDEFINED_LENGTH==length)
+			SkipUndefinedLength();
+		else
+			buffer_.Increment(length);
+
+		if(TAG_DATA_SET_PADDING==tag)
+			return;//we don't maintain padding.
+
+		DeferredElement element;
+		element.vr_=vr;
+		element.length_=length;
+		element.value_=ByteSpan(begin,buffer_.position());
+		AddDeferred(dataset_,tag,element,source_);
+	}
+
+	/*!
+		Steps over a value of undefined length, that is either a sequence
+		(Part 5, section 7.5) or encapsulated pixel data (Part 5, Annex A.4).
+		Both consist of items terminated by a Sequence Delimitation Item.
+	*/
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::SkipUndefinedLength()
+	{
+		for(;;)
+		{
+			Tag tag;
+			UINT32 length;
+			buffer_ >> tag;
+			buffer_ >> length;
+			if(TAG_SEQ_DELIM_ITEM==tag)
+				return;
+			Enforce(TAG_ITEM==tag,"Tag must be sequence item");
+			if(UNDEFINED_LENGTH==length)
+				SkipItem();
+			else
+				buffer_.Increment(length);
+		}
+	}
+
+	//!Steps over the elements of an item of undefined length, up to and including its delimiter.
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::SkipItem()
+	{
+		for(;;)
+		{
+			Tag tag;
+			buffer_ >> tag;
+			if(TAG_ITEM_DELIM_ITEM==tag)
+			{
+				UINT32 dummy_length;
+				buffer_ >> dummy_length;
+				return;
+			}
+			VR vr;
+			UINT32 length;
+			DecodeVRAndLength(tag,vr,length);
+			if(UNDEFINED_LENGTH==length)
+				SkipUndefinedLength();
+			else
+				buffer_.Increment(length);
+		}
+	}
+
 	/*!
 		Sequences are described in Part 5, section 7.5.
 	*/
-	void Decoder::DecodeSequence(Tag SequenceTag,UINT32 SequenceLength)
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::DecodeSequence(Tag SequenceTag,UINT32 SequenceLength)
 	{
 		//need to keep track of bytes read if SequenceLength is not UNDEFINED_LENGTH
-		Sequence sequence;
+		//on the heap, not in the arena, even though its items use the arena.  See StoredInArena.
+		boost::shared_ptr<Sequence> sequence=boost::make_shared<Sequence>();
 		UINT32 BytesLeftToRead=SequenceLength;
 		while(BytesLeftToRead>0)
 		{
 
-			UINT16 Group;
-			UINT16 Element;
-			buffer_>>Group;
-			buffer_>>Element;
-			Tag tag=makeTag(Group,Element);
+			Tag tag;
+			buffer_>>tag;
 
 			UINT32 ItemLength;
 			buffer_ >> ItemLength;
@@ -439,23 +615,23 @@ namespace dicom{
 			{
 			case TAG_ITEM:
 				{
-					DataSet data;
+					//decode straight into the sequence, rather than copying the item in afterwards.
+					sequence->push_back(DataSet(ArenaOf(dataset_)));
+					DataSet& data=sequence->back();
 
 					if(ItemLength!=UNDEFINED_LENGTH)
 					{
-						/* make a copy of relevant bit of buffer.
-						* This is time-intensive, but simplifies the code considerably.
+						/*
+							Decode from a cursor bounded by the item, which sits on the
+							same bytes as our own, so nothing is copied however deep
+							the nesting goes.
 						*/
 
-
-						Buffer b(buffer_.ExternalByteOrder_);
-						std::copy(buffer_.position(),buffer_.position()+ItemLength,std::back_inserter(b));
-						Decoder D(b,data,ts_);
+						ByteSpan span=buffer_.Take(ItemLength);
+						ByteCursor b(span.begin(),span.end(),buffer_.ExternalByteOrder_);
+						BasicDecoder<DataSet> D(b,data,ts_,bulk_owner_);
 						D.Decode();
 
-						//buffer_.position()+=ItemLength;
-						buffer_.Increment(ItemLength);
-
 						if(BytesLeftToRead!=UNDEFINED_LENGTH)
 							BytesLeftToRead-=ItemLength;
 					}
@@ -465,8 +641,8 @@ namespace dicom{
 						Just feed in current buffer and trust system to correctly increment I
 						*/
 
-						Buffer::iterator I=buffer_.position();
-						Decoder D(buffer_,data,ts_);
+						const BYTE* I=buffer_.position();
+						BasicDecoder<DataSet> D(buffer_,data,ts_,bulk_owner_);
 
 						D.Decode();
 
@@ -478,12 +654,9 @@ namespace dicom{
 
 					}
 
-					sequence.push_back(data);
 					if(BytesLeftToRead==0)
 					{
-
-						dataset_.Put<VR_SQ>(SequenceTag,sequence);
-
+						PutSequence(SequenceTag,sequence);
 						return;
 					}
 				}
@@ -494,8 +667,7 @@ namespace dicom{
 					cout<<"sequence delimination item length should really be zero." << endl;
 
 				//we're done
-
-				dataset_.Put<VR_SQ>(SequenceTag,sequence);
+				PutSequence(SequenceTag,sequence);
 
 				return;
 			default:
@@ -504,15 +676,16 @@ namespace dicom{
 			}
 		}
 
-		dataset_.Put<VR_SQ>(SequenceTag,sequence);
+		PutSequence(SequenceTag,sequence);
 	}
 
-	void Decoder::Decode()
+	template<typename DATA_SET>
+	void BasicDecoder<DATA_SET>::Decode()
 	{
 		try
         {
             bool controlLoop = true;
-            while(controlLoop && (buffer_.position()!=buffer_.end())){
+            while(controlLoop && !buffer_.AtEnd()){
                 controlLoop = DecodeElement();
             }
 		}
@@ -528,18 +701,369 @@ namespace dicom{
 	}
 
 
+	template<typename DATA_SET>
+	void ReadWithOptions(ByteCursor& cursor, DATA_SET& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner);
+
+	void ReadFromBuffer(ByteCursor& cursor, DataSet& data, TS transfer_syntax)
+	{
+		if(transfer_syntax.isDeflated())
+			return ReadWithOptions(cursor,data,transfer_syntax,DecodeOptions(),boost::shared_ptr<const void>());
+		Decoder d(cursor,data,transfer_syntax);
+		d.Decode();
+	}
+
+	template<typename DATA_SET>
+	void DecodeWithOptions(ByteCursor& cursor, DATA_SET& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner)
+	{
+		if(options.ReferenceBulkData_)
+			Enforce(owner.get()!=0,"Referencing bulk data needs something to keep the encoded bytes alive.");
+		boost::shared_ptr<const void> bulk_owner=options.ReferenceBulkData_ ? owner : boost::shared_ptr<const void>();
+
+		if(!options.Lazy_)
+		{
+			BasicDecoder<DATA_SET> d(cursor,data,transfer_syntax,&options,boost::shared_ptr<const DeferredSource>(),bulk_owner);
+			d.Decode();
+			return;
+		}
+
+		Enforce(owner.get()!=0,"Lazy decoding needs something to keep the encoded bytes alive.");
+		boost::shared_ptr<DeferredSource> source(new DeferredSource);
+		source->Owner_=owner;
+		source->TransferSyntax_=transfer_syntax.getUID();
+		source->ByteOrder_=cursor.ExternalByteOrder_;
+		source->ReferenceBulkData_=options.ReferenceBulkData_;
+
+		BasicDecoder<DATA_SET> d(cursor,data,transfer_syntax,&options,source,bulk_owner);
+		d.Decode();
+	}
+
+	/*!
+		A deflated data set is inflated in one go, and then decoded as the
+		Explicit VR Little Endian it really is.  It's the inflated bytes that
+		lazily decoded elements, or referenced bulk data, then point into.
+	*/
+	template<typename DATA_SET>
+	void ReadWithOptions(ByteCursor& cursor, DATA_SET& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner)
+	{
+		if(!transfer_syntax.isDeflated())
+			return DecodeWithOptions(cursor,data,transfer_syntax,options,owner);
+
+		boost::shared_ptr<std::vector<BYTE> > inflated(new std::vector<BYTE>);
+		try
+		{
+			Inflate(cursor.position(),cursor.position()+cursor.Remaining(),*inflated);
+		}
+		catch(dicom::exception& e)
+		{
+			throw DecoderError(e.what());
+		}
+		cursor.Increment(cursor.Remaining());
+
+		const BYTE* begin=inflated->empty() ? 0 : &inflated->front();
+		ByteCursor InflatedCursor(begin,begin+inflated->size(),__LITTLE_ENDIAN);
+		DecodeWithOptions(InflatedCursor,data,transfer_syntax,options,inflated);
+	}
+
+	void ReadFromBuffer(ByteCursor& cursor, DataSet& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner)
+	{
+		ReadWithOptions(cursor,data,transfer_syntax,options,owner);
+		if(options.TranscodeTo_!=UID())
+			Transcode(data,TS(options.TranscodeTo_));
+	}
+
+	void ReadFromBuffer(ByteCursor& cursor, FlatDataSet& data, TS transfer_syntax)
+	{
+		if(transfer_syntax.isDeflated())
+			return ReadWithOptions(cursor,data,transfer_syntax,DecodeOptions(),boost::shared_ptr<const void>());
+		BasicDecoder<FlatDataSet> d(cursor,data,transfer_syntax);
+		d.Decode();
+	}
+
+	void ReadFromBuffer(ByteCursor& cursor, FlatDataSet& data, TS transfer_syntax,
+		const DecodeOptions& options, boost::shared_ptr<const void> owner)
+	{
+		Enforce(!options.Lazy_,"FlatDataSet can't be decoded lazily.");
+		Enforce(options.TranscodeTo_==UID(),"FlatDataSet can't be transcoded.");
+		ReadWithOptions(cursor,data,transfer_syntax,options,owner);
+	}
+
 	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax)
     {
-		Decoder d(buffer,data,transfer_syntax);
-        d.Decode();
+		ByteCursor cursor=buffer.Cursor();
+		ReadFromBuffer(cursor,data,transfer_syntax);
+		buffer.Increment(cursor.Offset());
 	}
 
-	void ReadElementFromBuffer(Buffer& buffer, DataSet& ds,TS transfer_syntax)
+	void ReadElementFromBuffer(ByteCursor& cursor, DataSet& ds,TS transfer_syntax)
 	{
-		Decoder d(buffer,ds,transfer_syntax);
+		Decoder d(cursor,ds,transfer_syntax);
 		d.DecodeElement();
+	}
+
+	void ReadElementFromBuffer(Buffer& buffer, DataSet& ds,TS transfer_syntax)
+	{
+		ByteCursor cursor=buffer.Cursor();
+		ReadElementFromBuffer(cursor,ds,transfer_syntax);
+		buffer.Increment(cursor.Offset());
+	}
+
+	namespace
+	{
+		//!Works out whether a run of bytes holds the whole of an element, without decoding it.
+		/*!
+			Values of undefined length (sequences and encapsulated pixel data) are
+			walked item by item, see Part 5, sections 7.5 and A.4.
+		*/
+		class ElementExtent
+		{
+			ByteCursor cursor_;
+			bool ExplicitVR_;
+
+			bool Have(size_t n) const
+			{
+				return cursor_.Remaining()>=n;
+			}
+
+			bool Skip(UINT32 length)
+			{
+				if(!Have(length))
+					return false;
+				cursor_.Increment(length);
+				return true;
+			}
+
+			bool Item()
+			{
+				for(;;)
+				{
+					if(!Have(4))
+						return false;
+					Tag tag;
+					ByteCursor peek=cursor_;
+					peek >> tag;
+					if(TAG_ITEM_DELIM_ITEM==tag)
+						return Skip(8);
+					if(!Element())
+						return false;
+				}
+			}
+
+			bool UndefinedLength()
+			{
+				for(;;)
+				{
+					if(!Have(8))
+						return false;
+					Tag tag;
+					UINT32 length;
+					cursor_ >> tag;
+					cursor_ >> length;
+					if(TAG_SEQ_DELIM_ITEM==tag)
+						return true;
+					if(UNDEFINED_LENGTH==length)
+					{
+						if(!Item())
+							return false;
+					}
+					else if(!Skip(length))
+						return false;
+				}
+			}
+
+		public:
+			//!If we have a whole element's header, but not its value, this is how long the element is.
+			size_t KnownLength_;
+
+			ElementExtent(const BYTE* begin,const BYTE* end,int ByteOrder,bool ExplicitVR)
+				:cursor_(begin,end,ByteOrder),ExplicitVR_(ExplicitVR),KnownLength_(0){}
+
+			bool Element()
+			{
+				if(!Have(8))
+					return false;
+				Tag tag;
+				UINT32 length;
+				cursor_ >> tag;
+				if(ExplicitVR_ && GroupTag(tag)!=0xfffe)
+				{
+					UINT16 vr,w;
+					cursor_ >> vr;
+					cursor_ >> w;
+					if(HasLongLength(VR(vr)))
+					{
+						if(!Have(4))
+							return false;
+						cursor_ >> length;
+					}
+					else
+						length=w;
+				}
+				else
+					cursor_ >> length;
+
+				if(UNDEFINED_LENGTH==length)
+					return UndefinedLength();
+				if(!Have(length))
+				{
+					KnownLength_=cursor_.Offset()+length;
+					return false;
+				}
+				cursor_.Increment(length);
+				return true;
+			}
 
+			size_t Offset() const
+			{
+				return cursor_.Offset();
+			}
+		};
+	}//namespace
+
+	IncrementalDecoder::IncrementalDecoder(DataSet& data,TS transfer_syntax)
+		:data_(data),ts_(transfer_syntax),
+		ByteOrder_(transfer_syntax.isBigEndian()?__BIG_ENDIAN:__LITTLE_ENDIAN),
+		needed_(0)
+	{
+		if(transfer_syntax.isDeflated())
+			inflater_.reset(new Inflater);
 	}
+
+	size_t IncrementalDecoder::Feed(const BYTE* begin,const BYTE* end)
+	{
+		if(inflater_)
+		{
+			inflated_.clear();
+			try
+			{
+				inflater_->Inflate(begin,end,inflated_);
+			}
+			catch(dicom::exception& e)
+			{
+				throw DecoderError(e.what());
+			}
+			if(inflated_.empty())
+				return 0;
+			begin=&inflated_[0];
+			end=begin+inflated_.size();
+		}
+
+		size_t decoded=0;
+		if(pending_.empty())
+		{
+			//decode straight out of the caller's bytes, and only keep what's left over.
+			const BYTE* rest=DecodeComplete(begin,end,decoded);
+			pending_.assign(rest,end);
+			if(needed_>pending_.size())
+				pending_.reserve(needed_);
+			return decoded;
+		}
+
+		pending_.insert(pending_.end(),begin,end);
+		if(pending_.size()<needed_)
+			return 0;
+
+		const BYTE* p=&pending_[0];
+		const BYTE* rest=DecodeComplete(p,p+pending_.size(),decoded);
+		pending_.erase(pending_.begin(),pending_.begin()+(rest-p));
+		if(needed_>pending_.size())
+			pending_.reserve(needed_);
+		return decoded;
+	}
+
+	/*!
+		Decodes the run of complete elements at the start of [begin,end),
+		and returns where the first incomplete one starts.
+	*/
+	const BYTE* IncrementalDecoder::DecodeComplete(const BYTE* begin,const BYTE* end,size_t& decoded)
+	{
+		ElementExtent extent(begin,end,ByteOrder_,ts_.isExplicitVR());
+		size_t complete=0;
+		while(extent.Element())
+		{
+			complete=extent.Offset();
+			decoded++;
+		}
+		/*
+			If we don't know how long the next element is (it's got an undefined
+			length) we have to scan it again from the start next time, so wait
+			until we've got twice as much of it, rather than rescanning on
+			every chunk.
+		*/
+		size_t incomplete=end-begin-complete;
+		needed_=extent.KnownLength_ ? extent.KnownLength_-complete : std::max<size_t>(2*incomplete,incomplete+1);
+
+		ByteCursor cursor(begin,begin+complete,ByteOrder_);
+		Decoder d(cursor,data_,ts_);
+		while(!cursor.AtEnd())
+			d.DecodeElement();
+		return begin+complete;
+	}
+
+	void IncrementalDecoder::Finish()
+	{
+		if(inflater_ && !inflater_->Finished())
+			throw DecoderError("Deflated data set ended part way through.");
+		if(!pending_.empty())
+		{
+			//we may have been holding back an element that's complete, waiting for more.
+			size_t decoded=0;
+			const BYTE* p=&pending_[0];
+			const BYTE* rest=DecodeComplete(p,p+pending_.size(),decoded);
+			pending_.erase(pending_.begin(),pending_.begin()+(rest-p));
+		}
+		if(!pending_.empty())
+			throw DecoderError("Data set ended part way through an element.");
+	}
+	/*
+		These live here rather than in a DataSet.cpp because they need the Decoder.
+	*/
+
+	bool DataSet::MaterializeDeferred(const Tag tag) const
+	{
+		DeferredElements::iterator I=Deferred_.find(tag);
+		if(I==Deferred_.end())
+			return false;
+
+		/*
+			Each element is decoded onto a DataSet of its own first, and only
+			comes off the list once that's worked, so one that won't decode
+			stays deferred rather than disappearing.  Decoding onto this one
+			directly wouldn't do, as Put() would find it still deferred and come
+			back here.
+		*/
+		const DeferredSource& source=*Source_;
+		for(;I!=Deferred_.end() && I->first==tag;Deferred_.erase(I++))
+		{
+			DataSet decoded(GetArena());
+			ByteCursor cursor(I->second.value_.begin(),I->second.value_.end(),source.ByteOrder_);
+			Decoder d(cursor,decoded,TS(source.TransferSyntax_),
+				source.ReferenceBulkData_ ? source.Owner_ : boost::shared_ptr<const void>());
+			d.DecodeValue(tag,I->second.vr_,I->second.length_);
+
+			DataSet& data=*const_cast<DataSet*>(this);
+			data.insert(decoded.begin(),decoded.end());
+			if(TAG_PIXEL_DATA==tag)
+			{
+				data.OffsetTable_=decoded.OffsetTable_;
+				data.PixelDataSyntax_=decoded.PixelDataSyntax_;
+			}
+		}
+
+		if(Deferred_.empty())
+			Source_.reset();
+		return true;
+	}
+
+	void DataSet::Materialize() const
+	{
+		while(!Deferred_.empty())
+			MaterializeDeferred(Deferred_.begin()->first);
+	}
+
 };//namespace dicom
 
 /*
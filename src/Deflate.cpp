@@ -0,0 +1,133 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <zlib.h>
+#include "Deflate.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		//!Negative window bits give a raw deflate stream, without zlib's header and checksum.
+		const int RawDeflateWindowBits=-15;
+
+		std::string ZlibError(const char* what,z_stream& stream)
+		{
+			return std::string(what)+(stream.msg ? std::string(": ")+stream.msg : std::string());
+		}
+	}
+
+	DeflateSink::DeflateSink(EncoderSink& next,int level,size_t BlockSize)
+		:next_(next),stream_(new z_stream),block_(BlockSize)
+	{
+		if(0==BlockSize)
+			throw dicom::exception("DeflateSink needs a block size bigger than zero.");
+		memset(stream_.get(),0,sizeof(z_stream));
+		if(Z_OK!=deflateInit2(stream_.get(),level,Z_DEFLATED,RawDeflateWindowBits,8,Z_DEFAULT_STRATEGY))
+			throw dicom::exception(ZlibError("Couldn't start deflating",*stream_));
+		stream_->next_out=&block_[0];
+		stream_->avail_out=uInt(block_.size());
+	}
+
+	DeflateSink::~DeflateSink()
+	{
+		deflateEnd(stream_.get());
+	}
+
+	void DeflateSink::Flush(bool last)
+	{
+		next_.Write(&block_[0],block_.size()-stream_->avail_out,last);
+		stream_->next_out=&block_[0];
+		stream_->avail_out=uInt(block_.size());
+	}
+
+	/*!
+		A full block is only passed on when there's more output to come, which
+		there always is until the stream's been finished.
+	*/
+	void DeflateSink::Write(const BYTE* data,size_t length,bool last)
+	{
+		stream_->next_in=const_cast<Bytef*>(data);
+		stream_->avail_in=uInt(length);
+		for(;;)
+		{
+			if(0==stream_->avail_out)
+				Flush(false);
+			int result=deflate(stream_.get(),last ? Z_FINISH : Z_NO_FLUSH);
+			if(Z_STREAM_END==result)
+				break;
+			if(Z_OK!=result && Z_BUF_ERROR!=result)
+				throw dicom::exception(ZlibError("Failed deflating",*stream_));
+			if(!last && 0==stream_->avail_in && 0!=stream_->avail_out)
+				return;
+		}
+		Flush(true);
+	}
+
+	Inflater::Inflater()
+		:stream_(new z_stream),finished_(false)
+	{
+		memset(stream_.get(),0,sizeof(z_stream));
+		if(Z_OK!=inflateInit2(stream_.get(),RawDeflateWindowBits))
+			throw dicom::exception(ZlibError("Couldn't start inflating",*stream_));
+	}
+
+	Inflater::~Inflater()
+	{
+		inflateEnd(stream_.get());
+	}
+
+	namespace
+	{
+		//!Most that out is grown by at a time, so that a big input isn't met by a huge zero-filled allocation.
+		const size_t MaxInflateChunk=16*1024*1024;
+	}
+
+	/*!
+		out is grown a few times the size of the input at a go, which is about
+		what a data set compresses by, but no more than MaxInflateChunk.  zlib
+		counts in uInts, so the input is fed to it in slices that fit.
+		Anything after the end of the deflated data is ignored.
+	*/
+	void Inflater::Inflate(const BYTE* begin,const BYTE* end,std::vector<BYTE>& out)
+	{
+		const size_t MaxSlice=std::numeric_limits<uInt>::max();
+		const size_t chunk=std::min(std::max<size_t>(64*1024,4*size_t(end-begin)),MaxInflateChunk);
+		stream_->next_in=const_cast<Bytef*>(begin);
+		stream_->avail_in=0;
+		while(!finished_)
+		{
+			if(0==stream_->avail_in)
+				stream_->avail_in=uInt(std::min<size_t>(end-stream_->next_in,MaxSlice));
+			size_t start=out.size();
+			out.resize(start+chunk);
+			stream_->next_out=&out[start];
+			stream_->avail_out=uInt(chunk);
+			int result=inflate(stream_.get(),Z_NO_FLUSH);
+			out.resize(start+chunk-stream_->avail_out);
+			if(Z_STREAM_END==result)
+				finished_=true;
+			else if(Z_OK!=result && Z_BUF_ERROR!=result)
+				throw dicom::exception(ZlibError("Failed inflating",*stream_));
+			//stop once it's all been read, and all that's there has come out.
+			if(end==stream_->next_in && 0!=stream_->avail_out)
+				break;
+		}
+	}
+
+	void Inflate(const BYTE* begin,const BYTE* end,std::vector<BYTE>& out)
+	{
+		Inflater inflater;
+		inflater.Inflate(begin,end,out);
+		if(!inflater.Finished())
+			throw dicom::exception("Deflated data ends part way through.");
+	}
+}//namespace dicom
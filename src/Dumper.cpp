@@ -28,6 +28,7 @@ namespace dicom
 
 	void Dump(const DataSet& data,std::ostream& Out)
 	{
+		data.Materialize();
 		std::for_each(data.begin(),data.end(),Dumper(Out));
 	}
 
@@ -6,8 +6,14 @@
 *	See LICENSE.txt for copyright and licensing info.
 *************************************************************************/
 #include <iostream>
+#include <iterator>
+#include <algorithm>
 #include "Encoder.hpp"
 #include "Exceptions.hpp"
+#include "PixelData.hpp"
+#include "Deflate.hpp"
+#include "Codec.hpp"
+#include <boost/scoped_ptr.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/date_parsing.hpp>
 #include "iso646.h"
@@ -16,101 +22,165 @@ using namespace std;
 namespace dicom
 {
 
-	class Encoder
+	//!Stands in for a Buffer, but only counts the bytes it's given.
+	/*!
+		Running the Encoder onto one of these gives exactly the encoded
+		length, because the same code decides what would be written, but no
+		bytes are copied anywhere.
+	*/
+	class LengthCounter
 	{
 	public:
-		Encoder(Buffer& buffer,const DataSet& ds,TS ts):buffer_(buffer),dataset_(ds),ts_(ts){}
+		size_t length_;
+		LengthCounter():length_(0){}
+
+		template <typename T>
+		LengthCounter& operator << (T)
+		{
+			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);
+			length_+=sizeof(T);
+			return *this;
+		}
+		LengthCounter& operator << (Tag)
+		{
+			length_+=4;
+			return *this;
+		}
+		LengthCounter& operator << (const std::string& data)
+		{
+			length_+=data.size();
+			return *this;
+		}
+		template<typename T>
+		void AddVector(const std::vector<T>& data)
+		{
+			length_+=data.size()*sizeof(T);
+		}
+		void Append(const BYTE*,size_t length)
+		{
+			length_+=length;
+		}
+	};
+
+	//!Encodes a DATA_SET, which is either a DataSet or a FlatDataSet.
+	/*!
+		OUTPUT is where the bytes go, either a Buffer, or an EncoderOutput
+		that passes them on to an EncoderSink as it goes.
+	*/
+	template<typename DATA_SET,typename OUTPUT>
+	class BasicEncoder
+	{
+	public:
+		BasicEncoder(OUTPUT& output,const DATA_SET& ds,TS ts):output_(output),dataset_(ds),ts_(ts){}
 		void Encode();
 	private:
-		Buffer& buffer_;
-		const DataSet& dataset_;
+		OUTPUT& output_;
+		const DATA_SET& dataset_;
 		TS ts_;
 
-		void EncodeElement(const DataSet::value_type& element)const;
+		void EncodeElement(const typename DATA_SET::value_type& element)const;
+		typename DATA_SET::const_iterator SendTag(typename DATA_SET::const_iterator I);
+		void EncodePassingThrough(const DataSet& data);
+		std::vector<Tag> TagsToDecode(const DataSet& data) const;
+		void EncodePassingThrough(const FlatDataSet&){}//never read lazily.
+
+		//!The element's header is written afresh, but its value is copied as is.
+		void SendDeferred(Tag tag,const DeferredElement& element)
+		{
+			output_ << tag;
+			WriteLengthAndVR(element.length_,element.vr_);
+			output_.Append(element.value_.begin(),element.value_.size());
+		}
 		void WriteLengthAndVR(UINT32 length,VR vr);
-		void SendRange(DataSet::const_iterator Begin,DataSet::const_iterator End);
+		void SendRange(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End);
 		
 		void SendSequence(const Sequence& sequence);
 
-		template<VR vr>
-		void SendFundamentalType(DataSet::const_iterator Begin,DataSet::const_iterator End)
+		//!US, FD, SV etc.  Multiple values are written one after the other.
+		template<typename Type>
+		void SendFundamentalType(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End,VR vr)
 		{
-			typedef typename TypeFromVR<vr>::Type Type;
 			BOOST_STATIC_ASSERT(boost::is_fundamental<Type>::value);
 
-			UINT32 Length = (UINT32)dataset_.count(Begin->first);//Should be identical to End-Begin, but we don't have subtraction operator available.
+			UINT32 Length = (UINT32)std::distance(Begin,End);//Begin and End already bound the elements with this tag.
 			WriteLengthAndVR(sizeof(Type)*Length,vr);
 
 			for(;Begin!=End;Begin++)
 			{
 				Type data;
 				Begin->second >> data;
-				buffer_ << data;
+				output_ << data;
 			}
 		}
 
-		void SendAttributeTag(DataSet::const_iterator Begin,DataSet::const_iterator End)
+		//!OW, OF, OD, OL, OV and UN, which are a single vector.
+		template<typename Type>
+		void SendVector(typename DATA_SET::const_iterator Begin,VR vr)
 		{
-			UINT32 Length = (UINT32)dataset_.count(Begin->first);//Should be identical to End-Begin, but we don't have subtraction operator available.
+			const std::vector<Type>& data = Begin->second.template Get<std::vector<Type> >();
+			WriteLengthAndVR((UINT32)(data.size()*sizeof(Type)),vr);
+			output_.AddVector(data);
+		}
+
+		void SendAttributeTag(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End)
+		{
+			UINT32 Length = (UINT32)std::distance(Begin,End);//Begin and End already bound the elements with this tag.
 
 			WriteLengthAndVR(sizeof(Tag)*Length,VR_AT);
 			for(;Begin!=End;Begin++)
 			{
 				Tag data;
 				Begin->second >> data;
-				buffer_ << data;
+				output_ << data;
 			}
 		}
 
 
-		template <VR vr>
-		void SendString(DataSet::const_iterator Begin,DataSet::const_iterator End)
+		/*!
+			The length is worked out first, so that the values can be written
+			straight out one after the other, rather than joined together into
+			a temporary string.  Multiple values are separated by '\\'.
+		*/
+		template<typename Type>
+		void SendStrings(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End,VR vr,char padding)
 		{
-			StaticVRCheck<std::string,vr>();
 			Tag tag=Begin->first;
-			//delimiter character is '\'
-			std::string StringToSend;
-			for(;Begin!=End;Begin++)
+			size_t length=0;
+			for(typename DATA_SET::const_iterator I=Begin;I!=End;I++)
 			{
-				std::string s;
-				const Value& value=Begin->second;
-				if((vr!=value.vr()) or(tag!=Begin->first))// this block is basically an ASSERT, ie I expect it to never be entered.
+				const Value& value=I->second;
+				if((vr!=value.vr()) or(tag!=I->first))// this block is basically an ASSERT, ie I expect it to never be entered.
 					//we have a major problem.
 					throw dicom::exception("Some inconsistency in dataset.");
-				value >> s;
-				StringToSend.append(s);
-				StringToSend.append(1,'\\');//delimiter
+				length+=StringOf(value.Get<Type>()).size()+1;
 			}
-			StringToSend.erase(StringToSend.end()-1);//remove last delimiter.
-			if(StringToSend.size() bitand 0x01)//length is odd
-				StringToSend.append(1,' ');//string length must be even.
+			length--;//no delimiter after the last one.
+			bool pad=(length bitand 0x01);//string length must be even.
 
-			WriteLengthAndVR((UINT32)StringToSend.size(),vr);
-			buffer_<<StringToSend;
-		}
-		void SendUID(DataSet::const_iterator Begin, DataSet::const_iterator End)
-		{
-			Tag tag=Begin->first;
-			std::string StringToSend;
-			for(;Begin!=End;Begin++)
+			WriteLengthAndVR((UINT32)(length+pad),vr);
+			for(typename DATA_SET::const_iterator I=Begin;I!=End;I++)
 			{
-				UID uid;
-				const Value& value=Begin->second;
-				if((VR_UI!=value.vr()) or(tag!=Begin->first))
-					throw dicom::exception("Some inconsistency in dataset.");
-				value >> uid;
-				StringToSend.append(uid.str());
-				StringToSend.append(1,'\\');//delimiter
+				if(I!=Begin)
+					output_<<'\\';
+				output_<<StringOf(I->second.template Get<Type>());
 			}
-			StringToSend.erase(StringToSend.end()-1);//remove last delimiter.
-			if(StringToSend.size() bitand 0x01)	//length is odd
-				StringToSend.append(1,'\0');	//length must be even, NULL character is used for padding UIDs
+			if(pad)
+				output_<<padding;
+		}
 
-			WriteLengthAndVR((UINT32)StringToSend.size(),VR_UI);
-			buffer_<<StringToSend;
+		static const std::string& StringOf(const std::string& s){return s;}
+		static const std::string& StringOf(const UID& uid){return uid.str();}
+
+		void SendString(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End,VR vr)
+		{
+			SendStrings<std::string>(Begin,End,vr,' ');
+		}
+		void SendUID(typename DATA_SET::const_iterator Begin, typename DATA_SET::const_iterator End)
+		{
+			SendStrings<UID>(Begin,End,VR_UI,'\0');//NULL character is used for padding UIDs
 		}
 
-		void SendDate(DataSet::const_iterator Begin,DataSet::const_iterator End)
+		void SendDate(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End)
 		{
 			Tag tag=Begin->first;
 			std::string StringToSend;
@@ -129,54 +199,113 @@ namespace dicom
 				StringToSend.append(1,' ');//string length must be even.
 
 			WriteLengthAndVR((UINT32)StringToSend.size(),VR_DA);
-			buffer_<<StringToSend;
+			output_<<StringToSend;
 		}
-		//previous two functions are virtually identical apart from small detail in
-		//inner loop.  Please rationalise.
 
-		void SendOB(DataSet::const_iterator Begin, DataSet::const_iterator End)
+		/*!
+			Pixel data in an encapsulated transfer syntax is always sent as
+			fragments, even if there's only one, as Part 5, Annex A.4 requires.
+		*/
+		void SendOB(typename DATA_SET::const_iterator Begin, typename DATA_SET::const_iterator End)
 		{	
 			typedef TypeFromVR<VR_OB>::Type Type;
 			
-			Tag tag = Begin->first;
-			int fragments=dataset_.count(tag);
+			int fragments=(int)std::distance(Begin,End);
 
 			Enforce(ts_.isEncoded() || (1==fragments),"Only encoded data can have multiple image fragments.");
 
-			if(1==fragments)//just send the data
+			if(1==fragments && !(ts_.isEncoded() && TAG_PIXEL_DATA==Begin->first))//just send the data
 			{
-				const Type& ByteVector = Begin->second.Get<Type>();
+				const Type& ByteVector = Begin->second.template Get<Type>();
 				WriteLengthAndVR((UINT32)ByteVector.size(),VR_OB);
-				buffer_.AddVector(ByteVector);
+				output_.AddVector(ByteVector);
 				return;		
 			}
 			else	//send the data as a series of fragments as defined in Part5 Annex 4
 			{
 				WriteLengthAndVR(UNDEFINED_LENGTH,VR_OB);
 
-				//send empty offset table - not supported.
-
-				buffer_ << TAG_ITEM;
-				buffer_ << UINT32(0x00);//no offset table.
+				std::vector<UINT32> offsets=OffsetTable(Begin,End);
+				output_ << TAG_ITEM;
+				output_ << UINT32(offsets.size()*4);
+				for(std::vector<UINT32>::const_iterator I=offsets.begin();I!=offsets.end();++I)
+					output_ << *I;
 
 				for(;Begin!=End;Begin++)
 				{
-					buffer_ << TAG_ITEM;
-					const Type& ByteVector = Begin->second.Get<Type>();
-					buffer_ << UINT32(ByteVector.size());
-					buffer_.AddVector(ByteVector);
+					output_ << TAG_ITEM;
+					const Type& ByteVector = Begin->second.template Get<Type>();
+					output_ << UINT32(ByteVector.size());
+					output_.AddVector(ByteVector);
 				}
 
-				buffer_ << TAG_SEQ_DELIM_ITEM;
-				buffer_ << UINT32(0x00);			
+				output_ << TAG_SEQ_DELIM_ITEM;
+				output_ << UINT32(0x00);			
 			}
 
 		}
+
+		std::vector<UINT32> OffsetTable(typename DATA_SET::const_iterator Begin, typename DATA_SET::const_iterator End) const;
 	};
 
+	/*!
+		The offset table for the fragments from Begin to End.  The one that was
+		read is kept if it still points at the start of a fragment for every
+		frame.  Otherwise if there's a fragment per frame, or only one frame,
+		it's worked out afresh.  If neither, or if an offset won't fit in 32
+		bits, or if there's an Extended Offset Table (Part 3, C.7.6.3.1.8),
+		it's left empty.  So is it if Number of Frames can't be read, as the
+		table is optional and that's no reason not to send the pixel data.
+	*/
+	template<typename DATA_SET,typename OUTPUT>
+	std::vector<UINT32> BasicEncoder<DATA_SET,OUTPUT>::OffsetTable(typename DATA_SET::const_iterator Begin, typename DATA_SET::const_iterator End) const
+	{
+		std::vector<UINT32> offsets;
+		if(TAG_PIXEL_DATA!=Begin->first || dataset_.find(TAG_EXTENDED_OFFSET_TABLE)!=dataset_.end())
+			return offsets;
+
+		std::vector<UINT64> starts;
+		UINT64 start=0;
+		for(;Begin!=End;Begin++)
+		{
+			starts.push_back(start);
+			start+=8+Begin->second.template Get<TypeFromVR<VR_OB>::Type>().size();//item tag and length, then the fragment.
+		}
+
+		size_t frames;
+		try
+		{
+			frames=NumberOfFrames(dataset_);
+		}
+		catch(std::exception&)//e.g. empty, or not a number.
+		{
+			return offsets;
+		}
 
+		const std::vector<UINT32>& kept=dataset_.OffsetTable();
+		if(kept.size()==frames && !kept.empty() && 0==kept.front())
+		{
+			bool fits=true;
+			for(size_t i=0;fits && i<kept.size();i++)
+				fits=(i==0 || kept[i]>kept[i-1]) && std::binary_search(starts.begin(),starts.end(),UINT64(kept[i]));
+			if(fits)
+				return kept;
+		}
+
+		if(starts.size()!=frames && 1!=frames)
+			return offsets;
+		if(1==frames)
+			starts.resize(1);
+		if(starts.back()>0xffffffff)
+			return offsets;
+		offsets.assign(starts.begin(),starts.end());
+		return offsets;
+	}
 
-	void Encoder::SendRange(DataSet::const_iterator Begin,DataSet::const_iterator End)
+
+
+	template<typename DATA_SET,typename OUTPUT>
+	void BasicEncoder<DATA_SET,OUTPUT>::SendRange(typename DATA_SET::const_iterator Begin,typename DATA_SET::const_iterator End)
 	{
 	//we might want an ASSERT here to check that the range truly is consistent,
 	//i.e. only consists of elements sharing the same Tag and VR...
@@ -184,82 +313,54 @@ namespace dicom
 		Tag tag = Begin->first;
 		VR vr = Begin->second.vr();
 
-		buffer_ << tag;
+		output_ << tag;
 
-		switch(vr)
+		//VRs that share a C++ type are sent the same way, see VRTraits.
+		switch(GetVRTraits(vr).type_)
 		{
-		case VR_AE:
-			return SendString<VR_AE>(Begin,End);
-			//returSendFundamentalTypepe<VR_AE>(Begin,End);
-
-		case VR_AS:
-			return SendString<VR_AS>(Begin,End);
-		case VR_AT:
-			return SendAttributeTag(Begin,End);
-		case VR_CS:
-			return SendString<VR_CS>(Begin,End);
-		case VR_DA:
+		case TYPE_STRING:
+			return SendString(Begin,End,vr);
+		case TYPE_UID:
+			return SendUID(Begin,End);
+		case TYPE_DATE:
 			return SendDate(Begin,End);
-		case VR_DS:
-			return SendString<VR_DS>(Begin,End);
-		case VR_DT:
-			return SendString<VR_DT>(Begin,End);
-		case VR_FD:
-			return SendFundamentalType <VR_FD>(Begin,End);
-		case VR_FL:
-			return SendFundamentalType<VR_FL>(Begin,End);
-		case VR_IS:
-			return SendString<VR_IS>(Begin,End);
-		case VR_LO:
-			return SendString<VR_LO>(Begin,End);
-		case VR_LT:
-			return SendString<VR_LT>(Begin,End);
-		case VR_OB:
-			return SendOB(Begin,End);
-		case VR_OW:
-			{
-				typedef TypeFromVR<VR_OW>::Type Type;
-				const Type& WordVector = Begin->second.Get<Type>();
-
-				UINT32 ByteLength=WordVector.size()*2;
-				WriteLengthAndVR(ByteLength,VR_OW);
-
-				buffer_.AddVector(WordVector);
-			}
-			return;
-		case VR_PN:
-			return SendString<VR_PN>(Begin,End);
-		case VR_SH:
-			return SendString<VR_SH>(Begin,End);
-		case VR_SL:
-			return SendFundamentalType<VR_SL>(Begin,End);
-		case VR_SQ:
-		{
-			const Sequence& sequence=Begin->second.Get<Sequence>();
+		case TYPE_TAG:
+			return SendAttributeTag(Begin,End);
+		case TYPE_FLOAT:
+			return SendFundamentalType<float>(Begin,End,vr);
+		case TYPE_DOUBLE:
+			return SendFundamentalType<double>(Begin,End,vr);
+		case TYPE_INT16:
+			return SendFundamentalType<signed short>(Begin,End,vr);
+		case TYPE_UINT16:
+			return SendFundamentalType<UINT16>(Begin,End,vr);
+		case TYPE_SIGNED_LONG:
+			return SendFundamentalType<signed long>(Begin,End,vr);
+		case TYPE_UINT32:
+			return SendFundamentalType<UINT32>(Begin,End,vr);
+		case TYPE_INT64:
+			return SendFundamentalType<INT64>(Begin,End,vr);
+		case TYPE_UINT64:
+			return SendFundamentalType<UINT64>(Begin,End,vr);
+		case TYPE_BYTES:
+			if(VR_OB==vr)
+				return SendOB(Begin,End);
+			return SendVector<BYTE>(Begin,vr);
+		case TYPE_WORDS:
+			return SendVector<UINT16>(Begin,vr);
+		case TYPE_FLOATS:
+			return SendVector<float>(Begin,vr);
+		case TYPE_DOUBLES:
+			return SendVector<double>(Begin,vr);
+		case TYPE_LONGS:
+			return SendVector<UINT32>(Begin,vr);
+		case TYPE_VERY_LONGS:
+			return SendVector<UINT64>(Begin,vr);
+		case TYPE_SEQUENCE:
+		{
+			const Sequence& sequence=Begin->second.template Get<Sequence>();
 			return SendSequence(sequence);
 		}
-		case VR_SS:
-			return SendFundamentalType<VR_SS>(Begin,End);
-		case VR_ST:
-			return SendString<VR_ST>(Begin,End);
-		case VR_TM:
-			return SendString<VR_TM>(Begin,End);
-		case VR_UI:
-			return SendUID(Begin,End);
-		case VR_UL:
-			return SendFundamentalType<VR_UL>(Begin,End);
-		case VR_UN:
-			{
-				typedef TypeFromVR<VR_UN>::Type Type;
-				const Type& ByteVector = Begin->second.Get<Type>();
-				WriteLengthAndVR((UINT32)ByteVector.size(),VR_UN);
-				buffer_.AddVector(ByteVector);
-			}
-			return;
-		case VR_US:
-			return SendFundamentalType<VR_US>(Begin,End);
-		case VR_UT:
-			return SendString<VR_UT>(Begin,End);
 		default:
 			cout << "Unknown VR: " << vr  << " in EncodeElement()" << endl;
 			throw BadVR(vr);
@@ -267,41 +368,140 @@ namespace dicom
 	}
 
 
-	void Encoder::WriteLengthAndVR(UINT32 length,VR vr)
+	template<typename DATA_SET,typename OUTPUT>
+	void BasicEncoder<DATA_SET,OUTPUT>::WriteLengthAndVR(UINT32 length,VR vr)
 	{
 		if(ts_.isExplicitVR())
 		{
 
-			buffer_ << UINT16(vr);
-			if( VR_UN == vr || VR_SQ == vr || VR_OW == vr || VR_OB == vr || VR_UT == vr)
+			output_ << UINT16(vr);
+			if(HasLongLength(vr))
 			{
 
-				buffer_ << UINT16(0);	//reserved
-				buffer_ << length;		//4 bytes
+				output_ << UINT16(0);	//reserved
+				output_ << length;		//4 bytes
 			}
 			else
 			{
-				buffer_<<UINT16(length);//2 bytes
+				output_<<UINT16(length);//2 bytes
 			}
 		}
 		else
 		{
 			//no VR info sent
-			buffer_ << length;			//4 bytes
+			output_ << length;			//4 bytes
 		}
 
 	}
 
-	void Encoder::Encode()
+	template<typename DATA_SET,typename OUTPUT>
+	void BasicEncoder<DATA_SET,OUTPUT>::Encode()
 	{
-		DataSet::const_iterator I = dataset_.begin();
+		if(dataset_.HasDeferred())//it was read lazily.
+			return EncodePassingThrough(dataset_);
 
+		typename DATA_SET::const_iterator I = dataset_.begin();
 		while(I!=dataset_.end())
+			I=SendTag(I);
+	}
+
+	/*!
+		Sends every element with the same tag as I, and returns the one after.
+	*/
+	template<typename DATA_SET,typename OUTPUT>
+	typename DATA_SET::const_iterator BasicEncoder<DATA_SET,OUTPUT>::SendTag(typename DATA_SET::const_iterator I)
+	{
+		//elements with the same tag are adjacent, and usually there's only one,
+		//so stepping along is cheaper than searching with equal_range().
+		Tag tag=I->first;
+		typename DATA_SET::const_iterator End=I;
+		while(End!=dataset_.end() && End->first==tag)
+			++End;
+		SendRange(I,End);
+		return End;
+	}
+
+	namespace
+	{
+		//!Can an element that hasn't been decoded yet be copied straight into ts?
+		/*!
+			The value bytes are only the same if the byte order is.  Sequences,
+			and anything else of undefined length, have element headers of
+			their own inside, so the VR has to be explicit in both or implicit
+			in both.  Encapsulated pixel data is only any use in the transfer
+			syntax it was compressed for.
+		*/
+		bool CanPassThrough(const DeferredElement& element,TS source,TS ts)
 		{
-			Tag tag=I->first;
-			pair<DataSet::const_iterator,DataSet::const_iterator> p=dataset_.equal_range(tag);
-   			SendRange(p.first,p.second);
-			I=p.second;
+			if(source.isBigEndian()!=ts.isBigEndian())
+				return false;
+			bool nested=(VR_SQ==element.vr_ || UNDEFINED_LENGTH==element.length_);
+			if(nested && source.isExplicitVR()!=ts.isExplicitVR())
+				return false;
+			if(UNDEFINED_LENGTH==element.length_ && (VR_OB==element.vr_ || VR_OW==element.vr_))
+				return source.getUID()==ts.getUID();
+			//a 2 byte length field can't hold this.
+			if(ts.isExplicitVR() && !HasLongLength(element.vr_) && element.length_>0xffff)
+				return false;
+			return true;
+		}
+	}
+
+	//!Deferred elements of data that EncodePassingThrough() can't copy as they are.
+	template<typename DATA_SET,typename OUTPUT>
+	std::vector<Tag> BasicEncoder<DATA_SET,OUTPUT>::TagsToDecode(const DataSet& data) const
+	{
+		TS source(data.Source_->TransferSyntax_);
+		std::vector<Tag> decode;
+		for(DataSet::DeferredElements::const_iterator D=data.Deferred_.begin();D!=data.Deferred_.end();++D)
+			if(!CanPassThrough(D->second,source,ts_) || data.find(D->first)!=data.end())
+				decode.push_back(D->first);
+
+		//OffsetTable() reads these to write out decoded pixel data.
+		if(data.find(TAG_PIXEL_DATA)!=data.end() || std::find(decode.begin(),decode.end(),Tag(TAG_PIXEL_DATA))!=decode.end())
+		{
+			if(data.FindDeferred(TAG_NUMBER_OF_FRAMES))
+				decode.push_back(TAG_NUMBER_OF_FRAMES);
+			if(data.FindDeferred(TAG_EXTENDED_OFFSET_TABLE))
+				decode.push_back(TAG_EXTENDED_OFFSET_TABLE);
+		}
+		return decode;
+	}
+
+	/*!
+		Elements that were never decoded are copied out exactly as they came
+		in, merged in tag order with the ones that were.  Anything that can't
+		be copied, or that has decoded elements with the same tag (e.g. one
+		that was added with insert()), is decoded first.  So are the
+		attributes OffsetTable() reads when the pixel data has been decoded.
+
+		That decoding is done on a copy, so that the DataSet we were given
+		isn't changed, and can be encoded on several threads at once.
+	*/
+	template<typename DATA_SET,typename OUTPUT>
+	void BasicEncoder<DATA_SET,OUTPUT>::EncodePassingThrough(const DataSet& data)
+	{
+		std::vector<Tag> decode=TagsToDecode(data);
+		if(!decode.empty())
+		{
+			DataSet copy(data);
+			for(std::vector<Tag>::const_iterator T=decode.begin();T!=decode.end();++T)
+				copy.Materialize(*T);
+			BasicEncoder<DataSet,OUTPUT> E(output_,copy,ts_);
+			return E.Encode();
+		}
+
+		DataSet::const_iterator I=data.begin();
+		DataSet::DeferredElements::const_iterator D=data.Deferred_.begin();
+		while(I!=data.end() || D!=data.Deferred_.end())
+		{
+			if(D==data.Deferred_.end() || (I!=data.end() && I->first<D->first))
+				I=SendTag(I);
+			else
+			{
+				SendDeferred(D->first,D->second);
+				++D;
+			}
 		}
 	}
 
@@ -313,7 +513,8 @@ namespace dicom
 		think the second is the simplest...
 	*/
 
-	void Encoder::SendSequence(const Sequence& sequence)
+	template<typename DATA_SET,typename OUTPUT>
+	void BasicEncoder<DATA_SET,OUTPUT>::SendSequence(const Sequence& sequence)
 	{
 		//write tag
 		//write undefined length
@@ -330,18 +531,18 @@ namespace dicom
 
 		for(Sequence::const_iterator I=sequence.begin();I!=sequence.end();I++)
 		{
-			buffer_ << TAG_ITEM;
+			output_ << TAG_ITEM;
 
-			buffer_<<UNDEFINED_LENGTH;
-			Encoder E(buffer_,*I,ts_);
+			output_<<UNDEFINED_LENGTH;
+			BasicEncoder<DataSet,OUTPUT> E(output_,*I,ts_);
 			E.Encode();
 //write dataset
-			buffer_ << TAG_ITEM_DELIM_ITEM;
+			output_ << TAG_ITEM_DELIM_ITEM;
 
-			buffer_<<UINT32(0x00);
+			output_<<UINT32(0x00);
 		}
-		buffer_ << TAG_SEQ_DELIM_ITEM;
-		buffer_<<UINT32(0x00);
+		output_ << TAG_SEQ_DELIM_ITEM;
+		output_<<UINT32(0x00);
 	}
 
 
@@ -349,11 +550,94 @@ namespace dicom
 
 
 
+	size_t EncodedLength(const DataSet& data, TS transfer_syntax)
+	{
+		LengthCounter counter;
+		BasicEncoder<DataSet,LengthCounter> E(counter,data,transfer_syntax);
+		E.Encode();
+		return counter.length_;
+	}
+
+	size_t EncodedLength(const FlatDataSet& data, TS transfer_syntax)
+	{
+		LengthCounter counter;
+		BasicEncoder<FlatDataSet,LengthCounter> E(counter,data,transfer_syntax);
+		E.Encode();
+		return counter.length_;
+	}
+
+	namespace
+	{
+		//!Appends whatever it's given onto a Buffer.
+		class BufferSink : public EncoderSink
+		{
+			Buffer& buffer_;
+		public:
+			explicit BufferSink(Buffer& buffer):buffer_(buffer){}
+			void Write(const BYTE* data,size_t length,bool)
+			{
+				buffer_.Append(data,length);
+			}
+		};
+
+		//!A deflated data set goes through a DeflateSink on its way to sink.
+		template<typename DATA_SET>
+		void EncodeToSink(const DATA_SET& data, EncoderSink& sink, TS transfer_syntax, size_t BlockSize, int DeflateLevel)
+		{
+			boost::scoped_ptr<DeflateSink> deflate;
+			if(transfer_syntax.isDeflated())
+				deflate.reset(new DeflateSink(sink,DeflateLevel,BlockSize));
+
+			EncoderOutput output(deflate ? *deflate : sink,transfer_syntax.isBigEndian()?__BIG_ENDIAN:__LITTLE_ENDIAN,BlockSize);
+			BasicEncoder<DATA_SET,EncoderOutput> E(output,data,transfer_syntax);
+			E.Encode();
+			output.Finish();
+		}
+	}
+
 	void WriteToBuffer(const DataSet& data, Buffer& buffer, TS transfer_syntax)
 	{
-		Encoder E(buffer,data,transfer_syntax);
+		if(NeedsTranscoding(data,transfer_syntax))
+		{
+			DataSet transcoded(data);
+			Transcode(transcoded,transfer_syntax);
+			return WriteToBuffer(transcoded,buffer,transfer_syntax);
+		}
+		if(transfer_syntax.isDeflated())
+		{
+			BufferSink sink(buffer);
+			return EncodeToSink(data,sink,transfer_syntax,DefaultEncoderBlockSize,DefaultDeflateLevel);
+		}
+		BasicEncoder<DataSet,Buffer> E(buffer,data,transfer_syntax);
+		E.Encode();
+	}
+
+	void WriteToBuffer(const FlatDataSet& data, Buffer& buffer, TS transfer_syntax)
+	{
+		if(transfer_syntax.isDeflated())
+		{
+			BufferSink sink(buffer);
+			return EncodeToSink(data,sink,transfer_syntax,DefaultEncoderBlockSize,DefaultDeflateLevel);
+		}
+		BasicEncoder<FlatDataSet,Buffer> E(buffer,data,transfer_syntax);
 		E.Encode();
 	}
 
+	void WriteToSink(const DataSet& data, EncoderSink& sink, TS transfer_syntax, size_t BlockSize, int DeflateLevel)
+	{
+		if(NeedsTranscoding(data,transfer_syntax))
+		{
+			DataSet transcoded(data);
+			Transcode(transcoded,transfer_syntax);
+			return EncodeToSink(transcoded,sink,transfer_syntax,BlockSize,DeflateLevel);
+		}
+		EncodeToSink(data,sink,transfer_syntax,BlockSize,DeflateLevel);
+	}
+
+	void WriteToSink(const FlatDataSet& data, EncoderSink& sink, TS transfer_syntax, size_t BlockSize, int DeflateLevel)
+	{
+		EncodeToSink(data,sink,transfer_syntax,BlockSize,DeflateLevel);
+	}
+
 
 }//namespace dicom
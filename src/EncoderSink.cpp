@@ -0,0 +1,97 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <errno.h>
+#if (!defined _WIN32)
+	#include <unistd.h>
+#else
+	#include <io.h>
+#endif
+#include "EncoderSink.hpp"
+#include "Exceptions.hpp"
+#include "socket/SystemError.hpp"
+
+namespace dicom
+{
+	void StreamSink::Write(const BYTE* data,size_t length,bool)
+	{
+		if(length)
+			out_.write(reinterpret_cast<const char*>(data),length);
+		if(!out_)
+			throw dicom::exception("Failed writing to stream.");
+	}
+
+	void FileDescriptorSink::Write(const BYTE* data,size_t length,bool)
+	{
+		while(length)
+		{
+#ifdef _WIN32
+			int written=_write(fd_,data,static_cast<unsigned int>(length));
+#else
+			ssize_t written=::write(fd_,data,length);
+#endif
+			if(written<0)
+			{
+				if(EINTR==errno)
+					continue;
+				throw SystemError("Failed writing to file descriptor");
+			}
+			data+=written;
+			length-=written;
+		}
+	}
+
+	namespace
+	{
+		//!Where the block starts, unless BlockSize is smaller.  Enough for a command set.
+		const size_t InitialEncoderBlockSize=1024;
+	}
+
+	EncoderOutput::EncoderOutput(EncoderSink& sink,int ExternalByteOrder,size_t BlockSize)
+		:sink_(sink),BlockSize_(BlockSize),used_(0),ExternalByteOrder_(ExternalByteOrder)
+	{
+		if(0==BlockSize)
+			throw dicom::exception("EncoderOutput needs a block size bigger than zero.");
+	}
+
+	//!Doubles the block each time, so growing to BlockSize copies no more than BlockSize bytes all told.
+	void EncoderOutput::Grow(size_t size)
+	{
+		size=std::max(size,std::max(2*block_.size(),InitialEncoderBlockSize));
+		block_.resize(std::min(size,BlockSize_));
+	}
+
+	/*!
+		A full block is only passed on once there's more to go after it, so
+		that the sink always finds out which block is the last one.
+	*/
+	void EncoderOutput::Flush()
+	{
+		sink_.Write(block_.empty() ? 0 : &block_[0],used_,false);
+		used_=0;
+	}
+
+	void EncoderOutput::AppendSlow(const BYTE* data,size_t length)
+	{
+		while(length)
+		{
+			if(0==Space())
+				Flush();
+			size_t n=std::min(Space(),length);
+			memcpy(Reserve(n),data,n);
+			used_+=n;
+			data+=n;
+			length-=n;
+		}
+	}
+
+	void EncoderOutput::Finish()
+	{
+		sink_.Write(block_.empty() ? 0 : &block_[0],used_,true);
+		used_=0;
+	}
+}//namespace dicom
@@ -6,11 +6,20 @@
 *	See LICENSE.txt for copyright and licensing info.
 *************************************************************************/
 
+#if defined(__unix__) || defined(__APPLE__)
+	#define DICOMLIB_HAVE_MMAP
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
 #include "File.hpp"
 #include "Buffer.hpp"
 #include "TransferSyntax.hpp"
 #include "Decoder.hpp"
 #include "Encoder.hpp"
+#include "DataDictionary.hpp"
 
 namespace dicom
 {
@@ -34,7 +43,141 @@ namespace dicom
 		return StreamSize;
 	}
 
-    void ReadFromStream(std::istream& In, DataSet& data)
+	/*!
+		Used when only part of a data set has been asked for.  Copies the
+		top level elements we want from the stream into Out_, and steps over
+		everything else without reading it into memory.  Out_ can then be
+		handed to the Decoder as usual.
+	*/
+	class PartialStreamReader
+	{
+		std::istream& In_;
+		TS ts_;
+		const int ByteOrder_;
+		std::vector<BYTE>& Out_;
+
+		//!Appends the next n bytes of the stream to Out_.
+		bool Copy(size_t n)
+		{
+			size_t start=Out_.size();
+			Out_.resize(start+n);
+			if(n==0)
+				return true;
+			In_.read((char*)&Out_[start],n);
+			size_t got=In_.gcount();
+			Out_.resize(start+got);
+			return got==n;
+		}
+
+		//!Steps over the next n bytes of the stream.
+		bool Skip(size_t n)
+		{
+			if(!In_.seekg(n,std::ios::cur))
+			{
+				//not seekable, so we have to read through it.
+				In_.clear();
+				In_.ignore(n);
+				return size_t(In_.gcount())==n;
+			}
+			return true;
+		}
+
+		//!Appends an element or item header to Out_, and parses it.
+		bool ReadHeader(Tag& tag, VR& vr, UINT32& length)
+		{
+			size_t start=Out_.size();
+			if(!Copy(4))
+				return false;
+			ByteCursor(&Out_[start],&Out_[start]+4,ByteOrder_) >> tag;
+
+			start=Out_.size();
+			if(ts_.isExplicitVR() && GroupTag(tag)!=0xfffe)//items and delimiters never have a VR
+			{
+				if(!Copy(4))
+					return false;
+				ByteCursor c(&Out_[start],&Out_[start]+4,ByteOrder_);
+				UINT16 w;
+				c >> w;
+				vr=VR(w);
+				if (HasLongLength(vr))//see Part5 / 7.1.2
+				{
+					start=Out_.size();
+					if(!Copy(4))
+						return false;
+					ByteCursor(&Out_[start],&Out_[start]+4,ByteOrder_) >> length;
+				}
+				else
+				{
+					c >> w;
+					length=w;
+				}
+			}
+			else
+			{
+				vr=GetVR(tag);
+				if(!Copy(4))
+					return false;
+				ByteCursor(&Out_[start],&Out_[start]+4,ByteOrder_) >> length;
+			}
+			return true;
+		}
+
+		//!Items and elements up to and including terminator.
+		bool Contents(bool keep, Tag terminator)
+		{
+			for(;;)
+			{
+				size_t start=Out_.size();
+				Tag tag;
+				VR vr;
+				UINT32 length;
+				bool ok=ReadHeader(tag,vr,length);
+				if(!keep)
+					Out_.resize(start);
+				if(!ok)
+					return false;
+				if(tag==terminator)
+					return true;
+				if(!Value(length,keep,tag==TAG_ITEM ? TAG_ITEM_DELIM_ITEM : TAG_SEQ_DELIM_ITEM))
+					return false;
+			}
+		}
+
+		//!terminator is what ends the value if it has undefined length.
+		bool Value(UINT32 length, bool keep, Tag terminator)
+		{
+			if(length==UNDEFINED_LENGTH)
+				return Contents(keep,terminator);
+			return keep ? Copy(length) : Skip(length);
+		}
+
+	public:
+		PartialStreamReader(std::istream& In, TS ts, int ByteOrder, std::vector<BYTE>& Out)
+			:In_(In),ts_(ts),ByteOrder_(ByteOrder),Out_(Out){}
+
+		void Read(const DecodeOptions& options)
+		{
+			for(;;)
+			{
+				size_t start=Out_.size();
+				Tag tag;
+				VR vr;
+				UINT32 length;
+				if(!ReadHeader(tag,vr,length) || options.PastEnd(tag))
+				{
+					Out_.resize(start);
+					return;
+				}
+				bool keep=options.Wanted(tag);
+				if(!keep)
+					Out_.resize(start);
+				if(!Value(length,keep,TAG_SEQ_DELIM_ITEM))
+					return;//truncated, let the Decoder deal with whatever we've got.
+			}
+		}
+	};
+
+    void ReadFromStream(std::istream& In, DataSet& data, const DecodeOptions& options)
 	{
 		data.clear();
 
@@ -72,63 +215,51 @@ namespace dicom
 			file to start reading the DataSet.
 		*/
 
-		size_t BytesToRead=GetStreamSize(In)-In.tellg();
-
-
 		int ByteOrder=ts.isBigEndian()?
 			__BIG_ENDIAN:__LITTLE_ENDIAN;
 
 
-		Buffer buffer(ByteOrder);
+		/*
+			The bytes are shared rather than owned by a local Buffer, because
+			a lazily decoded data set needs to hang on to them.
+		*/
+		boost::shared_ptr<std::vector<BYTE> > bytes(new std::vector<BYTE>);
 
-		//Read data from stream onto buffer.
-		buffer.assign(BytesToRead,0);
-        unsigned char* pData=&buffer.front();
+		if(options.Partial() && !ts.isDeflated())//a deflated data set can't be stepped through without inflating it.
+		{
+			PartialStreamReader reader(In,ts,ByteOrder,*bytes);
+			reader.Read(options);
+		}
+		else
+		{
+			size_t BytesToRead=GetStreamSize(In)-In.tellg();
+			bytes->resize(BytesToRead);
+			if(BytesToRead)
+				In.read((char*)&bytes->front(),BytesToRead);//This is the most time intensive part. Can we speed it up any?
+		}
 
-		In.read((char*)pData,BytesToRead);//This is the most time intensive part. Can we speed it up any?
         //Transfer data from buffer onto dataset
-
-        ReadFromBuffer(buffer,data,ts);
+		const BYTE* pData=bytes->empty()?0:&bytes->front();
+		ByteCursor cursor(pData,pData+bytes->size(),ByteOrder);
+        ReadFromBuffer(cursor,data,ts,options,bytes);
 	}
 
-	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts)
+	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts,int DeflateLevel)
 	{
 		FileMetaInformation MetaInfo(data,ts);
 		MetaInfo.Write(Out);
 
-		int ByteOrder=ts.isBigEndian()?
-			__BIG_ENDIAN:__LITTLE_ENDIAN;
-
-		Buffer buffer(ByteOrder);
 		UID TS_UID=MetaInfo.MetaElements_(TAG_TRANSFER_SYNTAX_UID).Get<UID>();
 
-
-		WriteToBuffer(data,buffer,TS(TS_UID));
-
-		/*
-			The following is in desperate need of optimisation!
-			UCDMC99 had a 'WriteToStream' version of WriteToBuffer,
-			that matched exactly the syntax of WriteToBuffer.  Two identical
-			functions is bad, can we trick it with templates or
-			virtual functions??
-		*/
-
-		/*
-		while(buffer.position()!=buffer.end())
-		{
-			Out.put(*buffer.position());
-			buffer.Increment(1);
-		}*/
-
-		int bytes_to_write=buffer.end()-buffer.position();
-		Out.write((const char *)(&*buffer.position()),bytes_to_write);
-		buffer.Increment(bytes_to_write);
+		//encoded a block at a time, so we never hold the whole thing in memory.
+		StreamSink sink(Out);
+		WriteToSink(data,sink,TS(TS_UID),DefaultEncoderBlockSize,DeflateLevel);
 	}
 
-		void Read(std::string FileName,DataSet& data)
+		void Read(std::string FileName,DataSet& data, const DecodeOptions& options)
 		{
 			std::ifstream in(FileName.c_str(),std::ios::binary);
-			ReadFromStream(in,data);
+			ReadFromStream(in,data,options);
 		}
 
         void Read(std::istream in, DataSet& data)
@@ -137,9 +268,104 @@ namespace dicom
             ReadFromStream(in,data);
         }
 
-		void Write(const DataSet& data, std::string FileName, TS ts)
+	/*!
+		A whole file, mapped read-only into memory.  Where mmap isn't available
+		we fall back to reading the file into a vector, which still saves
+		the stream version's zero fill.
+	*/
+	class MappedFile:boost::noncopyable
+	{
+		const BYTE* begin_;
+		size_t size_;
+#ifndef DICOMLIB_HAVE_MMAP
+		std::vector<BYTE> bytes_;
+#endif
+	public:
+		MappedFile(const std::string& FileName):begin_(0),size_(0)
+		{
+#ifdef DICOMLIB_HAVE_MMAP
+			int fd=open(FileName.c_str(),O_RDONLY);
+			if(fd<0)
+				throw FileException("Couldn't open file: " + FileName);
+			struct stat info;
+			if(fstat(fd,&info)!=0)
+			{
+				close(fd);
+				throw FileException("Couldn't stat file: " + FileName);
+			}
+			size_=info.st_size;
+			if(size_)
+			{
+				void* p=mmap(0,size_,PROT_READ,MAP_PRIVATE,fd,0);
+				if(p==MAP_FAILED)
+				{
+					close(fd);
+					throw FileException("Couldn't map file: " + FileName);
+				}
+				madvise(p,size_,MADV_SEQUENTIAL);
+				begin_=static_cast<const BYTE*>(p);
+			}
+			close(fd);//the mapping stays valid.
+#else
+			std::ifstream in(FileName.c_str(),std::ios::binary);
+			if(!in)
+				throw FileException("Couldn't open file: " + FileName);
+			size_=GetStreamSize(in);
+			bytes_.resize(size_);
+			if(size_)
+			{
+				in.read((char*)&bytes_[0],size_);
+				begin_=&bytes_[0];
+			}
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef DICOMLIB_HAVE_MMAP
+			if(begin_)
+				munmap(const_cast<BYTE*>(begin_),size_);
+#endif
+		}
+
+		const BYTE* begin() const{return begin_;}
+		const BYTE* end() const{return begin_+size_;}
+	};
+
+		void ReadMapped(std::string FileName, DataSet& data, const DecodeOptions& options)
+		{
+			data.clear();
+
+			boost::shared_ptr<MappedFile> file(new MappedFile(FileName));
+			const BYTE* start=file->begin();
+
+			UID TransferSyntaxUID=IMPL_VR_LE_TRANSFER_SYNTAX;//default
+			try
+			{
+				ByteCursor cursor(file->begin(),file->end(),__LITTLE_ENDIAN);
+				FileMetaInformation MetaInfo(cursor);
+				MetaInfo.MetaElements_(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntaxUID;
+				start=cursor.position();
+			}
+			catch (FileMetaInfoException& e)
+			{
+				//no meta info, so start from the beginning, see ReadFromStream()
+			}
+
+			TS ts(TransferSyntaxUID);
+			int ByteOrder=ts.isBigEndian()?
+				__BIG_ENDIAN:__LITTLE_ENDIAN;
+
+			DecodeOptions mapped=options;
+			mapped.ReferenceBulkData_=true;
+
+			ByteCursor body(start,file->end(),ByteOrder);
+			ReadFromBuffer(body,data,ts,mapped,file);
+		}
+
+		void Write(const DataSet& data, std::string FileName, TS ts, int DeflateLevel)
 		{
 			std::ofstream out(FileName.c_str(),std::ios::binary);//what's default behaviour if file already exists?
-			WriteToStream(data,out,ts);
+			WriteToStream(data,out,ts,DeflateLevel);
 		}
 }//namespace dicom
@@ -133,6 +133,42 @@ namespace dicom
 	}
 
 
+	FileMetaInformation::FileMetaInformation(ByteCursor& In)
+	{
+		if(In.Remaining()<128+4)
+			throw FileMetaInfoException("Couldn't read preamble.");
+
+		ByteSpan preamble=In.Take(128);
+		std::copy(preamble.begin(),preamble.end(),Preamble_);
+
+		ByteSpan prefix=In.Take(4);
+		if(std::string(prefix.begin(),prefix.end()) !="DICM")
+			throw FileMetaInfoException("Prefix is not 'DICM'.");
+
+		ByteCursor cursor(In.position(),In.end(),__LITTLE_ENDIAN);//Section 7.1 says this has to be used.
+		TS ts(EXPL_VR_LE_TRANSFER_SYNTAX/*TS::EXPL_VR_LE*/); //Section 7.1 says this has to be used.
+
+		if(cursor.Remaining()<12)
+			throw FileMetaInfoException("Couldn't read group length.");
+		ReadElementFromBuffer(cursor,MetaElements_,ts);//gets the 'length' element.
+
+		Tag tag=MetaElements_.begin()->first;
+		if(tag!=TAG_FILE_INFO_GR_LEN)
+			throw exception("First tag must be group length");
+
+		UINT32 FileMetaInfoLength;
+		MetaElements_.begin()->second >> FileMetaInfoLength;
+		if(cursor.Remaining()<FileMetaInfoLength)
+			throw FileMetaInfoException("File meta information is truncated.");
+
+		ByteSpan group=cursor.Take(FileMetaInfoLength);
+		ByteCursor elements(group.begin(),group.end(),__LITTLE_ENDIAN);
+		ReadFromBuffer(elements,MetaElements_,ts);
+
+		In.Increment(cursor.Offset());
+	}
+
+
 	void FileMetaInformation::Write(std::ostream& Out)
 	{
 		//first the preamble...
@@ -148,10 +184,6 @@ namespace dicom
 
 		WriteToBuffer(MetaElements_,buffer,TS(EXPL_VR_LE_TRANSFER_SYNTAX/*TS::EXPL_VR_LE*/));//Section 7.1 says this syntax has to be used.
 
-		while(buffer.position()!=buffer.end())
-		{
-			Out.put(*buffer.position());
-			buffer.Increment(1);
-		}
+		Out.write(reinterpret_cast<const char*>(&buffer[0]),buffer.size());
 	}
 }//namespace dicom
@@ -11,26 +11,16 @@
 #include "Encoder.hpp"
 namespace dicom
 {
-	//!Figure out the length in bytes of a dataset by writing it to a temporary buffer.
+	//!Figure out the length in bytes of a dataset.
 	/*!
-		This is probably an inefficient way of doing this, but generally
-		speaking we'll only use it with small datasets like DIMSE commands
-		and file meta-information, of the order of a couple
-		of hundred bytes at most, so I don't think this will have
-		much impact on performance.
-
 		Note that the group length is dependent on which transfer syntax we use, as
-		explicit vr writes more info than implicit vr.
+		explicit vr writes more info than implicit vr.  EncodedLength() works
+		this out without encoding the data set into a throwaway buffer.
 	*/
 
 	UINT32 GroupLength(const DataSet& data,TS ts)
 	{
-		int ByteOrder=ts.isBigEndian()?
-			__BIG_ENDIAN:__LITTLE_ENDIAN;
-
-		Buffer buffer(ByteOrder);
-		WriteToBuffer(data,buffer,ts);
-		return (buffer.size());
+		return static_cast<UINT32>(EncodedLength(data,ts));
 	}
 
 }//namespace dicomlib
@@ -0,0 +1,190 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <algorithm>
+#include "MessageAssembler.hpp"
+#include "ServiceBase.hpp"
+#include "aarj.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace Implementation
+	{
+		namespace
+		{
+			//!Most of a PDV we read in one go.
+			const UINT32 MaxPDVChunk=64*1024;
+
+			//!PDU and PDV lengths are always big endian.
+			UINT32 BigEndianLength(const BYTE* length)
+			{
+				return (UINT32(length[0])<<24)|(UINT32(length[1])<<16)|(UINT32(length[2])<<8)|UINT32(length[3]);
+			}
+		}
+
+		MessageAssembler::MessageAssembler(ServiceBase& service)
+			:service_(service)
+			,state_(PDU_HEADER)
+			,HeaderRead_(0)
+			,WholeRead_(0)
+			,PDULeft_(0)
+			,PDVLeft_(0)
+			,MessageHeader_(0)
+			,ReadingDataSet_(false)
+		{
+		}
+
+		bool MessageAssembler::ReadAvailable(bool AssociationNegotiated)
+		{
+			for(;;)
+			{
+				switch(state_)
+				{
+				case PDU_HEADER:
+					if(!Fill(header_,HeaderRead_,sizeof(header_)))
+						return false;
+					HeaderRead_=0;
+					if(AssociationNegotiated && PDataTF::ItemType==header_[0])
+					{
+						PDULeft_=BigEndianLength(header_+2);
+						if(service_.MaxPDULength_ && PDULeft_>service_.MaxPDULength_)
+							Abort("P-DATA-TF is longer than the Maximum PDU Length we offered.");
+						state_=PDV_HEADER;
+					}
+					else
+					{
+						UINT32 length=BigEndianLength(header_+2);
+						if(length>MaxWholePDU)
+							Abort("PDU is too long.");
+						whole_.assign(header_,header_+sizeof(header_));
+						whole_.resize(sizeof(header_)+length);
+						WholeRead_=sizeof(header_);
+						state_=WHOLE_PDU;
+					}
+					break;
+
+				case WHOLE_PDU:
+					if(!Fill(&whole_[0],WholeRead_,whole_.size()))
+						return false;
+					service_.GetSocket()->PutBack(reinterpret_cast<const char*>(&whole_[0]),whole_.size());
+					std::vector<BYTE>().swap(whole_);
+					state_=PDU_HEADER;
+					return true;
+
+				case PDV_HEADER:
+					if(0==PDULeft_)
+					{
+						state_=PDU_HEADER;
+						break;
+					}
+					if(PDULeft_<sizeof(header_))
+						Abort("P-DATA-TF ends part way through a PDV header.");
+					if(!Fill(header_,HeaderRead_,sizeof(header_)))
+						return false;
+					HeaderRead_=0;
+					PDVLeft_=BigEndianLength(header_);
+					if(PDVLeft_<2 || PDVLeft_>PDULeft_-sizeof(UINT32))
+						Abort("PDV length doesn't fit its P-DATA-TF.");
+					PDULeft_-=PDVLeft_+sizeof(UINT32);
+					PDVLeft_-=2;
+					MessageHeader_=header_[5];
+					if(!decoder_)//the first fragment of a new message.
+					{
+						service_.Received_.clear();
+						decoder_.reset(new IncrementalDecoder(command_,TS(IMPL_VR_LE_TRANSFER_SYNTAX)));
+					}
+					state_=PDV_DATA;
+					break;
+
+				case PDV_DATA:
+					if(!ReadPDV())
+						return false;
+					state_=PDV_HEADER;
+					if((MessageHeader_ & MessageControlHeader::LAST_FRAGMENT) && EndOfFragments())
+						return true;
+					break;
+				}
+			}
+		}
+
+		bool MessageAssembler::PartRead() const
+		{
+			return !(PDU_HEADER==state_ && 0==HeaderRead_) || decoder_;
+		}
+
+		//!Reads towards want bytes at begin, of which we already have some.  Returns true once we've got them all.
+		bool MessageAssembler::Fill(BYTE* begin,size_t& have,size_t want)
+		{
+			while(have<want)
+			{
+				int BytesRead=service_.GetSocket()->ReadAvailable(reinterpret_cast<char*>(begin+have),int(want-have));
+				if(BytesRead<0)
+					throw Network::ConnectionLost();
+				if(0==BytesRead)
+					return false;
+				have+=BytesRead;
+			}
+			return true;
+		}
+
+		//!Feeds the rest of the PDV to the decoder, as far as it's arrived.  Returns true once it's all in.
+		bool MessageAssembler::ReadPDV()
+		{
+			BYTE chunk[MaxPDVChunk];
+			while(PDVLeft_)
+			{
+				int BytesRead=service_.GetSocket()->ReadAvailable(reinterpret_cast<char*>(chunk),int(std::min(PDVLeft_,MaxPDVChunk)));
+				if(BytesRead<0)
+					throw Network::ConnectionLost();
+				if(0==BytesRead)
+					return false;
+				decoder_->Feed(chunk,chunk+BytesRead);
+				PDVLeft_-=BytesRead;
+			}
+			return true;
+		}
+
+		/*!
+			The data set, if there's one, is decoded just as the handlers'
+			ServiceBase::Read() calls would decode it.  Returns true once
+			we've got the whole message.
+		*/
+		bool MessageAssembler::EndOfFragments()
+		{
+			decoder_->Finish();
+			decoder_.reset();
+			service_.Received_.push_back(DataSet());
+			if(ReadingDataSet_)
+			{
+				service_.Received_.back().swap(data_);
+				ReadingDataSet_=false;
+				return true;
+			}
+
+			UINT16 DataSetType=DataSetStatus::NO_DATA_SET;
+			if(command_.find(TAG_DATA_SET_TYPE)!=command_.end())
+				command_(TAG_DATA_SET_TYPE)>>DataSetType;
+			service_.Received_.back().swap(command_);
+			if(DataSetStatus::NO_DATA_SET==DataSetType)
+				return true;
+
+			decoder_.reset(new IncrementalDecoder(data_,TS(IMPL_VR_LE_TRANSFER_SYNTAX)));
+			ReadingDataSet_=true;
+			return false;
+		}
+
+		//!Sends an A-ABORT, and throws.
+		void MessageAssembler::Abort(const char* problem)
+		{
+			primitive::AAbortRQ abort_request(primitive::AAbortRQ::DICOM_SERVICE_PROVIDER,
+				primitive::AAbortRQ::INVALID_PDU_PARAMETER);
+			abort_request.Write(*service_.GetSocket());
+			throw dicom::exception(problem);
+		}
+	}//namespace Implementation
+}//namespace dicom
@@ -0,0 +1,227 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <algorithm>
+#include "PixelData.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		UINT16 GetUINT16(const DataSet& data,Tag tag,UINT16 missing)
+		{
+			std::vector<Value> values=data.Values(tag);
+			return values.empty() ? missing : values.front().Get<UINT16>();
+		}
+	}
+
+	ImageFormat::ImageFormat(const DataSet& data)
+		:Rows_(data(TAG_ROWS).Get<UINT16>()),Columns_(data(TAG_COLUMNS).Get<UINT16>()),
+		SamplesPerPixel_(GetUINT16(data,TAG_SAMPLES_PER_PX,1)),
+		Planar_(1==GetUINT16(data,TAG_PLANAR_CONFIG,0))
+	{
+		size_t bits=GetUINT16(data,TAG_BITS_ALLOC,8);
+		Enforce(0!=bits && 0==bits%8,"Samples that aren't a whole number of bytes aren't supported.");
+		BytesPerSample_=bits/8;
+	}
+
+	FrameIndex::FrameIndex(const DataSet& data,TS transfer_syntax)
+		:encapsulated_(false)
+	{
+		size_t frames=NumberOfFrames(data);
+
+		const DeferredElement* deferred=data.FindDeferred(TAG_PIXEL_DATA);
+		if(deferred)
+		{
+			const DeferredSource& source=*data.GetDeferredSource();
+			if(UNDEFINED_LENGTH==deferred->length_)
+			{
+				owner_=source.Owner_;
+				IndexEncapsulated(data,deferred->value_,source.ByteOrder_,frames);
+				return;
+			}
+			//native bytes can stay where they are unless they'd need swapping.
+			if(source.ByteOrder_==__BYTE_ORDER || 8==GetUINT16(data,TAG_BITS_ALLOC,8))
+			{
+				owner_=source.Owner_;
+				IndexNative(data,deferred->value_,frames);
+				return;
+			}
+		}
+
+		values_=data.Values(TAG_PIXEL_DATA);
+		if(values_.empty())
+			throw TagNotFound(TAG_PIXEL_DATA);
+		if(transfer_syntax.isEncoded())
+			IndexFragments(data,frames);
+		else
+			IndexNative(data,values_.front().Bytes(),frames);
+	}
+
+	/*!
+		bytes is the whole of the pixel data's value, i.e. the Basic Offset
+		Table item, then the fragments, then the Sequence Delimitation Item.
+		See Part 5, Annex A.4.
+	*/
+	void FrameIndex::IndexEncapsulated(const DataSet& data,ByteSpan bytes,int ByteOrder,size_t frames)
+	{
+		encapsulated_=true;
+		ByteCursor cursor(bytes.begin(),bytes.end(),ByteOrder);
+
+		Tag tag;
+		UINT32 length;
+		cursor >> tag;
+		cursor >> length;
+		Enforce(TAG_ITEM==tag,"Offset table must be defined in encoded data");
+		std::vector<UINT64> offsets(length/4);
+		for(std::vector<UINT64>::iterator I=offsets.begin();I!=offsets.end();++I)
+		{
+			UINT32 offset;
+			cursor >> offset;
+			*I=offset;
+		}
+
+		//offsets are from the first byte of the first fragment's item tag.
+		const BYTE* first=cursor.position();
+		std::vector<ByteSpan> fragments;
+		std::vector<UINT64> starts;
+		while(!cursor.AtEnd())
+		{
+			UINT64 start=cursor.position()-first;
+			cursor >> tag;
+			cursor >> length;
+			if(TAG_SEQ_DELIM_ITEM==tag)
+				break;
+			Enforce(TAG_ITEM==tag,"Tag must be sequence item");
+			starts.push_back(start);
+			fragments.push_back(cursor.Take(length));
+		}
+
+		//the Extended Offset Table is there for when offsets don't fit in 32 bits.
+		std::vector<Value> extended=data.Values(TAG_EXTENDED_OFFSET_TABLE);
+		if(!extended.empty())
+			offsets=extended.front().Get<std::vector<UINT64> >();
+
+		AssignFragments(fragments,starts,offsets,frames);
+	}
+
+	//!offsets are to fragment starts, from the first fragment's item tag.
+	void FrameIndex::AssignFragments(const std::vector<ByteSpan>& fragments,const std::vector<UINT64>& starts,
+		const std::vector<UINT64>& offsets,size_t frames)
+	{
+		if(offsets.empty())
+		{
+			if(fragments.size()==frames)
+			{
+				for(size_t i=0;i<frames;i++)
+					frames_.push_back(std::vector<ByteSpan>(1,fragments[i]));
+			}
+			else
+			{
+				Enforce(1==frames,"Can't tell which fragments belong to which frame without an offset table.");
+				frames_.push_back(fragments);
+			}
+			return;
+		}
+
+		std::vector<size_t> firsts;
+		for(std::vector<UINT64>::const_iterator I=offsets.begin();I!=offsets.end();++I)
+		{
+			std::vector<UINT64>::const_iterator F=std::lower_bound(starts.begin(),starts.end(),*I);
+			Enforce(F!=starts.end() && *F==*I,"Offset table entry doesn't point at a fragment.");
+			Enforce(firsts.empty() || size_t(F-starts.begin())>firsts.back(),"Offset table entries must increase.");
+			firsts.push_back(F-starts.begin());
+		}
+		firsts.push_back(fragments.size());
+		for(size_t i=0;i+1<firsts.size();i++)
+			frames_.push_back(std::vector<ByteSpan>(fragments.begin()+firsts[i],fragments.begin()+firsts[i+1]));
+	}
+
+	/*!
+		The Decoder has already split the pixel data into one OB value per
+		fragment, and put the offset table onto the DataSet.
+	*/
+	void FrameIndex::IndexFragments(const DataSet& data,size_t frames)
+	{
+		encapsulated_=true;
+		std::vector<ByteSpan> fragments;
+		std::vector<UINT64> starts;
+		UINT64 start=0;
+		for(std::vector<Value>::const_iterator I=values_.begin();I!=values_.end();++I)
+		{
+			fragments.push_back(I->Bytes());
+			starts.push_back(start);
+			start+=8+fragments.back().size();//item tag and length, then the fragment.
+		}
+
+		std::vector<UINT64> offsets;
+		std::vector<Value> extended=data.Values(TAG_EXTENDED_OFFSET_TABLE);
+		if(!extended.empty())
+			offsets=extended.front().Get<std::vector<UINT64> >();
+		else
+			offsets.assign(data.OffsetTable().begin(),data.OffsetTable().end());
+
+		AssignFragments(fragments,starts,offsets,frames);
+	}
+
+	void FrameIndex::IndexNative(const DataSet& data,ByteSpan bytes,size_t frames)
+	{
+		size_t FrameSize=ImageFormat(data).FrameSize();
+		Enforce(FrameSize*frames<=bytes.size(),"Pixel data is shorter than Number of Frames says.");
+
+		for(size_t i=0;i<frames;i++)
+		{
+			const BYTE* begin=bytes.begin()+i*FrameSize;
+			frames_.push_back(std::vector<ByteSpan>(1,ByteSpan(begin,begin+FrameSize)));
+		}
+	}
+
+	const std::vector<ByteSpan>& FrameIndex::Fragments(size_t n) const
+	{
+		if(n>=frames_.size())
+			throw dicom::exception("Frame number out of range.");
+		return frames_[n];
+	}
+
+	ByteSpan FrameIndex::Frame(size_t n,std::vector<BYTE>& scratch) const
+	{
+		const std::vector<ByteSpan>& fragments=Fragments(n);
+		if(1==fragments.size())
+			return fragments.front();
+
+		scratch.clear();
+		for(std::vector<ByteSpan>::const_iterator I=fragments.begin();I!=fragments.end();++I)
+			scratch.insert(scratch.end(),I->begin(),I->end());
+		return scratch.empty() ? ByteSpan() : ByteSpan(&scratch[0],&scratch[0]+scratch.size());
+	}
+
+	void PutExtendedOffsetTable(DataSet& data,TS transfer_syntax)
+	{
+		Enforce(transfer_syntax.isEncoded(),"Only encapsulated pixel data has an offset table.");
+		data.erase(TAG_EXTENDED_OFFSET_TABLE);
+		data.erase(TAG_EXTENDED_OFFSET_TABLE_LENGTHS);
+
+		//so that the Basic Offset Table isn't passed through with it.
+		data.Materialize(TAG_PIXEL_DATA);
+
+		FrameIndex index(data,transfer_syntax);
+		std::vector<UINT64> offsets,lengths;
+		UINT64 offset=0;
+		for(size_t i=0;i<index.size();i++)
+		{
+			const std::vector<ByteSpan>& fragments=index.Fragments(i);
+			Enforce(1==fragments.size(),"The Extended Offset Table needs each frame to be a single fragment.");
+			offsets.push_back(offset);
+			lengths.push_back(fragments.front().size());
+			offset+=8+fragments.front().size();
+		}
+		data.Put<VR_OV>(TAG_EXTENDED_OFFSET_TABLE,offsets);
+		data.Put<VR_OV>(TAG_EXTENDED_OFFSET_TABLE_LENGTHS,lengths);
+		data.SetOffsetTable(std::vector<UINT32>());
+	}
+}//namespace dicom
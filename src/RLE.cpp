@@ -0,0 +1,220 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <string.h>
+#include <algorithm>
+#include "RLE.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		//!See Part 5, G.5
+		const size_t RLEHeaderSize=64;
+		const size_t MaxRLESegments=15;
+
+		//!Where the bytes of one segment are in a frame: every stride_ bytes from offset_.
+		struct Plane
+		{
+			size_t offset_;
+			size_t stride_;
+		};
+
+		/*!
+			Segments go sample by sample, and within each sample from the most
+			significant byte to the least, see Part 5, G.2
+		*/
+		Plane PlaneOf(const ImageFormat& format,size_t segment)
+		{
+			size_t sample=segment/format.BytesPerSample_;
+			size_t byte=segment%format.BytesPerSample_;
+			if(__BYTE_ORDER==__LITTLE_ENDIAN)
+				byte=format.BytesPerSample_-1-byte;
+
+			Plane plane;
+			if(format.Planar_)
+			{
+				plane.offset_=sample*format.Pixels()*format.BytesPerSample_+byte;
+				plane.stride_=format.BytesPerSample_;
+			}
+			else
+			{
+				plane.offset_=sample*format.BytesPerSample_+byte;
+				plane.stride_=format.SamplesPerPixel_*format.BytesPerSample_;
+			}
+			return plane;
+		}
+
+		size_t Segments(const ImageFormat& format)
+		{
+			size_t segments=format.SamplesPerPixel_*format.BytesPerSample_;
+			Enforce(segments<=MaxRLESegments,"RLE can't hold more than 15 bytes per pixel.");
+			return segments;
+		}
+
+		//!These simple loops are left for the compiler to vectorize.
+		void Gather(const BYTE* from,size_t stride,size_t n,BYTE* to)
+		{
+			if(1==stride)
+				memcpy(to,from,n);
+			else
+				for(size_t i=0;i<n;i++)
+					to[i]=from[i*stride];
+		}
+
+		void Scatter(const BYTE* from,size_t n,BYTE* to,size_t stride)
+		{
+			if(1==stride)
+				memcpy(to,from,n);
+			else
+				for(size_t i=0;i<n;i++)
+					to[i*stride]=from[i];
+		}
+
+		//!Most PackBits could ever take for n bytes, i.e. all literals.
+		size_t PackBitsBound(size_t n)
+		{
+			return n+(n+127)/128;
+		}
+
+		/*!
+			A byte repeated at least 3 times is sent as a replicate run, up to 128
+			at a time.  Everything else goes as literal runs of up to 128 bytes.
+			See Part 5, G.3.1
+		*/
+		BYTE* PackBits(const BYTE* in,size_t n,BYTE* out)
+		{
+			const BYTE* end=in+n;
+			while(in<end)
+			{
+				const BYTE* limit=std::min(end,in+128);
+				const BYTE* run=in+1;
+				while(run<limit && *run==*in)
+					++run;
+				size_t count=run-in;
+				if(count>=3)
+				{
+					*out++=BYTE(257-count);//i.e. -(count-1)
+					*out++=*in;
+					in=run;
+					continue;
+				}
+
+				//a literal run, up to where the next replicate run starts.
+				const BYTE* start=in;
+				while(in<limit && !(in+2<end && in[0]==in[1] && in[1]==in[2]))
+					++in;
+				count=in-start;
+				*out++=BYTE(count-1);
+				memcpy(out,start,count);
+				out+=count;
+			}
+			return out;
+		}
+
+		//!Decompresses [in,end) into exactly n bytes at out.
+		/*!
+			Anything left over at the end of the segment, such as the padding
+			byte, is ignored.  Runs that would go past the end of a row of the
+			plane are fine, but not past the end of the plane.
+		*/
+		void UnpackBits(const BYTE* in,const BYTE* end,BYTE* out,size_t n)
+		{
+			BYTE* OutEnd=out+n;
+			while(out<OutEnd && in<end)
+			{
+				int header=static_cast<signed char>(*in++);
+				if(header>=0)
+				{
+					size_t count=header+1;
+					Enforce(count<=size_t(end-in) && count<=size_t(OutEnd-out),"RLE literal run goes past the end of its segment.");
+					memcpy(out,in,count);
+					in+=count;
+					out+=count;
+				}
+				else if(header!=-128)//which is a no-op
+				{
+					size_t count=1-header;
+					Enforce(in<end && count<=size_t(OutEnd-out),"RLE replicate run goes past the end of its segment.");
+					memset(out,*in++,count);
+					out+=count;
+				}
+			}
+			Enforce(out==OutEnd,"RLE segment is too short for the frame.");
+		}
+
+		//!The header is always little endian.
+		void PutUINT32(BYTE* to,UINT32 value)
+		{
+			to[0]=BYTE(value);
+			to[1]=BYTE(value>>8);
+			to[2]=BYTE(value>>16);
+			to[3]=BYTE(value>>24);
+		}
+
+		UINT32 GetUINT32(const BYTE* from)
+		{
+			return UINT32(from[0])|(UINT32(from[1])<<8)|(UINT32(from[2])<<16)|(UINT32(from[3])<<24);
+		}
+	}
+
+	/*!
+		Each row is compressed separately, as Part 5, G.3.1 asks.  Each
+		segment is padded to an even length.
+	*/
+	void RLEEncodeFrame(const BYTE* frame,const ImageFormat& format,std::vector<BYTE>& fragment)
+	{
+		size_t segments=Segments(format);
+		size_t pixels=format.Pixels();
+		std::vector<BYTE> plane(pixels);
+
+		size_t start=fragment.size();
+		size_t bound=RLEHeaderSize+segments*(format.Rows_*PackBitsBound(format.Columns_)+1);
+		fragment.resize(start+bound);
+		BYTE* header=&fragment[start];
+		memset(header,0,RLEHeaderSize);
+		PutUINT32(header,UINT32(segments));
+
+		BYTE* out=header+RLEHeaderSize;
+		for(size_t segment=0;segment<segments;segment++)
+		{
+			PutUINT32(header+4*(segment+1),UINT32(out-header));
+			Plane p=PlaneOf(format,segment);
+			if(pixels)
+				Gather(frame+p.offset_,p.stride_,pixels,&plane[0]);
+			for(size_t row=0;row<format.Rows_;row++)
+				out=PackBits(&plane[row*format.Columns_],format.Columns_,out);
+			if((out-header)&1)
+				*out++=0;
+		}
+		fragment.resize(out-&fragment[0]);
+	}
+
+	void RLEDecodeFrame(ByteSpan fragment,const ImageFormat& format,BYTE* frame)
+	{
+		size_t segments=Segments(format);
+		size_t pixels=format.Pixels();
+		Enforce(fragment.size()>=RLEHeaderSize,"RLE fragment is too short for its header.");
+
+		const BYTE* header=fragment.begin();
+		Enforce(GetUINT32(header)==segments,"RLE fragment has the wrong number of segments for the image.");
+
+		std::vector<BYTE> plane(pixels);
+		for(size_t segment=0;segment<segments;segment++)
+		{
+			UINT32 begin=GetUINT32(header+4*(segment+1));
+			UINT32 end=(segment+1<segments) ? GetUINT32(header+4*(segment+2)) : UINT32(fragment.size());
+			Enforce(RLEHeaderSize<=begin && begin<=end && end<=fragment.size(),"RLE segment offsets are out of order.");
+			if(0==pixels)
+				continue;
+			UnpackBits(header+begin,header+end,&plane[0],pixels);
+			Plane p=PlaneOf(format,segment);
+			Scatter(&plane[0],pixels,frame+p.offset_,p.stride_);
+		}
+	}
+}//namespace dicom
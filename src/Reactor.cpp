@@ -0,0 +1,299 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+#if defined(__linux__)
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "Reactor.hpp"
+#include "ThreadSpecificServer.hpp"
+
+namespace dicom
+{
+	namespace Implementation
+	{
+		namespace
+		{
+			//!How many events each I/O thread takes from epoll at a time.
+			const int MaxEvents=64;
+
+			//!How often, in seconds, we look for associations that have stopped part way through a message.
+			const int SweepInterval=1;
+		}
+
+		Reactor::Reactor(Server& server,size_t IOThreads,size_t Workers,size_t MaxQueued,int ReadTimeout)
+			:server_(server)
+			,IOThreads_(IOThreads)
+			,ReadTimeout_(ReadTimeout)
+			,epoll_(epoll_create1(EPOLL_CLOEXEC))
+			,listener_(0)
+			,NextSweep_(0)
+		{
+			if(epoll_<0)
+				throw SystemError("epoll_create1");
+			if(0==IOThreads_)
+			{
+				close(epoll_);
+				throw dicom::exception("Reactor needs at least one I/O thread.");
+			}
+			workers_.reset(new WorkerPool(Workers,MaxQueued));
+		}
+
+		Reactor::~Reactor()
+		{
+			//handlers that are already running get to finish, but reads don't.
+			Interrupt();
+			workers_.reset();
+			for(Associations::iterator I=associations_.begin();I!=associations_.end();++I)
+				I->second->Close();
+			associations_.clear();
+			close(epoll_);
+		}
+
+		void Reactor::Serve(Network::ServerSocket& listener)
+		{
+			listener_=&listener;
+			Watch(listener.GetSocketDescriptor(),EPOLL_CTL_ADD);
+			//not one shot, so that it wakes every I/O thread.
+			Watch(server_.KillFlagDescriptor(),EPOLL_CTL_ADD,EPOLLIN);
+
+			boost::thread_group threads;
+			for(size_t i=0;i<IOThreads_;i++)
+				threads.create_thread(boost::bind(&Reactor::Run,this));
+			threads.join_all();
+			server_.LogMessage("Kill flag raised, accepting no more connections.");
+		}
+
+		/*!
+			Sockets are watched with EPOLLONESHOT, so each event goes to only
+			one I/O thread, and nothing more is heard about that socket until
+			it's been dealt with and is watched again.  The I/O threads wake
+			every SweepInterval to look for stalled associations (see Sweep()),
+			and otherwise only the kill flag wakes them to finish.
+		*/
+		void Reactor::Run()
+		{
+			epoll_event events[MaxEvents];
+			try
+			{
+				for(;;)
+				{
+					int count=epoll_wait(epoll_,events,MaxEvents,SweepInterval*1000);
+					if(count<0 && EINTR==errno)
+						continue;
+					if(count<0)
+						throw SystemError("epoll_wait");
+					Sweep();
+					for(int i=0;i<count;i++)
+					{
+						SOCKET descriptor=events[i].data.fd;
+						if(descriptor==server_.KillFlagDescriptor())
+							return;
+						if(descriptor==listener_->GetSocketDescriptor())
+							Accept();
+						else
+							Dispatch(descriptor);
+					}
+				}
+			}
+			catch(std::exception& e)//we can't carry on without epoll, so take the whole server down.
+			{
+				server_.LogError(e.what());
+				server_.RaiseKillFlag();
+			}
+		}
+
+		void Reactor::Accept()
+		{
+			try
+			{
+				Network::AcceptedSocket* socket=new Network::AcceptedSocket(*listener_);
+				socket->SetNoDelay();
+				socket->SetReadTimeout(ReadTimeout_);
+				SOCKET descriptor=socket->GetSocketDescriptor();
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					associations_[descriptor].reset(new ThreadSpecificServer(socket,server_));
+				}
+				Watch(descriptor,EPOLL_CTL_ADD);
+			}
+			catch(std::exception& e)
+			{
+				server_.LogError(e.what());
+			}
+			Watch(listener_->GetSocketDescriptor(),EPOLL_CTL_MOD);
+		}
+
+		/*!
+			Whatever has arrived is read here on the I/O thread, and only once
+			there's a whole message (or some other PDU) is the association
+			handed to a worker.  So a worker only runs the handler and sends
+			the response, and never waits on a slow peer.  Until then the
+			association goes back into the epoll set, with a deadline if it's
+			stopped part way through something (see Sweep()).
+
+			If the work queue is full (see Server::SetLimits()) a new association
+			is turned away as soon as anything arrives on it.  Messages on
+			associations we've already taken on are queued regardless, so that
+			the I/O thread never waits on the workers.  That can't run away with
+			us, as an association is out of the epoll set while its message is
+			queued, so there's never more than one in the queue for each.
+		*/
+		void Reactor::Dispatch(SOCKET descriptor)
+		{
+			boost::shared_ptr<ThreadSpecificServer> association;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Associations::iterator I=associations_.find(descriptor);
+				if(I==associations_.end())
+					return;
+				association=I->second;
+			}
+
+			if(!association->AssociationNegotiated_ && !association->PartRead() && workers_->Saturated())
+			{
+				association->RejectAsBusy();
+				Close(descriptor);
+				return;
+			}
+
+			try
+			{
+				bool ready=association->ReadAvailable();
+				SetDeadline(descriptor,!ready && association->PartRead());
+				if(!ready)
+				{
+					Watch(descriptor,EPOLL_CTL_MOD);
+					return;
+				}
+			}
+			catch(std::exception& e)
+			{
+				server_.LogError(e.what());
+				server_.LogError("This connection will close.");
+				Close(descriptor);
+				return;
+			}
+
+			workers_->PostNow(boost::bind(&Reactor::Work,this,descriptor));
+		}
+
+		//!Runs on a worker, once Dispatch() has read a message on descriptor.
+		void Reactor::Work(SOCKET descriptor)
+		{
+			boost::shared_ptr<ThreadSpecificServer> association;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Associations::iterator I=associations_.find(descriptor);
+				if(I==associations_.end())
+					return;
+				association=I->second;
+			}
+
+			if(!server_.KillFlagRaised() && association->HandleNextMessage())
+			{
+				try
+				{
+					Watch(descriptor,EPOLL_CTL_MOD);
+					return;
+				}
+				catch(std::exception& e)
+				{
+					server_.LogError(e.what());
+				}
+			}
+			Close(descriptor);
+		}
+
+		void Reactor::Watch(SOCKET descriptor,int operation,UINT32 events)
+		{
+			epoll_event event;
+			event.events=events;
+			event.data.u64=0;
+			event.data.fd=descriptor;
+			if(epoll_ctl(epoll_,operation,descriptor,&event))
+				throw SystemError("epoll_ctl");
+		}
+
+		/*!
+			The association comes out of the map before its socket is closed, so
+			that the descriptor can't be reused by a new connection while it's
+			still in there.
+		*/
+		void Reactor::Close(SOCKET descriptor)
+		{
+			boost::shared_ptr<ThreadSpecificServer> association;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Associations::iterator I=associations_.find(descriptor);
+				if(I==associations_.end())
+					return;
+				association=I->second;
+				associations_.erase(I);
+				deadlines_.erase(descriptor);
+			}
+			epoll_ctl(epoll_,EPOLL_CTL_DEL,descriptor,0);
+			association->Close();
+		}
+
+		void Reactor::SetDeadline(SOCKET descriptor,bool PartRead)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(PartRead && ReadTimeout_>0)
+				deadlines_[descriptor]=time(0)+ReadTimeout_;
+			else
+				deadlines_.erase(descriptor);
+		}
+
+		/*!
+			Dispatch() never waits for the rest of a message, so the socket's
+			read timeout (see Server::SetReadTimeout()) doesn't apply there.
+			Instead, an association that has sent part of something gets
+			ReadTimeout seconds from then, and each time more arrives the clock
+			starts again.  If it runs out, the read side is shut down, as in
+			Interrupt(), so the I/O thread finds the connection gone and closes
+			it the usual way.  An association that's idle between messages has
+			no deadline, and one that's with a worker is never swept.
+		*/
+		void Reactor::Sweep()
+		{
+			time_t now=time(0);
+			boost::mutex::scoped_lock lock(mutex_);
+			if(now<NextSweep_)
+				return;
+			NextSweep_=now+SweepInterval;
+			for(Deadlines::iterator I=deadlines_.begin();I!=deadlines_.end();)
+			{
+				if(I->second<=now)
+				{
+					server_.LogError("Timed out reading part of a message.");
+					shutdown(I->first,SHUT_RD);
+					deadlines_.erase(I++);
+				}
+				else
+					++I;
+			}
+		}
+
+		/*!
+			Shutting down the read side makes a read that's blocked waiting for
+			the rest of a message return straight away, and the worker then
+			closes the association as it would for any lost connection.  Sockets
+			are only closed once they're out of the map, so none of these can
+			have been closed (and the descriptor reused) under us.
+		*/
+		void Reactor::Interrupt()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			for(Associations::iterator I=associations_.begin();I!=associations_.end();++I)
+				shutdown(I->first,SHUT_RD);
+		}
+	}//namespace Implementation
+}//namespace dicom
+
+#endif//__linux__
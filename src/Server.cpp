@@ -26,6 +26,9 @@
 
 #include <exception>
 #include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 #include <boost/thread/thread.hpp>
 
@@ -40,6 +43,7 @@
 #include "ServiceBase.hpp"
 
 #include "ThreadSpecificServer.hpp"
+#include "Reactor.hpp"
 
 using std::string;using std::cout; using std::endl;
 
@@ -67,16 +71,33 @@ namespace dicom
 	Server::Server()
 		:ServerThread_(NULL)
 		,KillFlag(false)
+		,IOThreads_(0)
+		,Workers_(0)
+		,MaxPDULength_(DefaultMaxPDULength)
+		,ReadTimeout_(DefaultReadTimeout)
+		,MaxAssociations_(0)
+		,MaxAssociationsPerAE_(0)
+		,MaxQueuedMessages_(0)
+		,OpenAssociations_(0)
 		,CurrentLogger_(&DefaultLogger_)
 	{
 		//is the following line a standard requirment???
 		//AcceptableAbstractSyntaxes_.insert(UID_VERIFICATION_SOP_CLASS);
+#ifndef _WIN32
+		if(pipe(KillPipe_))
+			throw SystemError("pipe");
+		fcntl(KillPipe_[0],F_SETFD,FD_CLOEXEC);
+		fcntl(KillPipe_[1],F_SETFD,FD_CLOEXEC);
+#endif
 	}
 
 	Server::~Server()
 	{
 		this->Stop();
-
+#ifndef _WIN32
+		close(KillPipe_[0]);
+		close(KillPipe_[1]);
+#endif
 	}
 	//!Start listening for connections on 'port'
 	/*!
@@ -92,14 +113,37 @@ namespace dicom
 		//on the relevant port, and start up server threads
 		//as needed.
 
-		boost::thread_group threads;
+		size_t IOThreads,Workers,MaxQueued;
+		int ReadTimeout;
+		{
+			boost::mutex::scoped_lock scoped_lock(mutex_);
+			IOThreads=IOThreads_;
+			Workers=Workers_;
+			MaxQueued=MaxQueuedMessages_;
+			ReadTimeout=ReadTimeout_;
+		}
 
 		//Open a socket to listen for new connections.
 		Network::ServerSocket TheServerSocket(port);
 
+		if(Workers)
+		{
+#if defined(__linux__)
+			Implementation::Reactor reactor(*this,IOThreads,Workers,MaxQueued,ReadTimeout);
+			reactor.Serve(TheServerSocket);
+			return;
+#else
+			LogMessage("Event driven serving needs epoll, so serving a thread per connection.");
+#endif
+		}
+
+		boost::thread_group threads;
+
 		while(ClientConnectionPending(&TheServerSocket))
 		{
 			Network::AcceptedSocket* pAccepter=new Network::AcceptedSocket(TheServerSocket);//blocks, waiting for a client.
+			pAccepter->SetNoDelay();
+			pAccepter->SetReadTimeout(ReadTimeout);
 
 			//Note that the socket object must be deleted in the newly created thread.
 			//see comments in ThreadSpecificServer::operator()
@@ -149,6 +193,77 @@ namespace dicom
 	}
 
 
+	void Server::SetEventDriven(size_t IOThreads,size_t Workers)
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex_);
+		IOThreads_=IOThreads;
+		Workers_=Workers;
+	}
+
+
+	void Server::SetMaxPDULength(UINT32 Length)
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex_);
+		MaxPDULength_=Length;
+	}
+
+	UINT32 Server::GetMaxPDULength()
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex_);
+		return MaxPDULength_;
+	}
+
+	void Server::SetReadTimeout(int Seconds)
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex_);
+		ReadTimeout_=Seconds;
+	}
+
+	int Server::GetReadTimeout()
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex_);
+		return ReadTimeout_;
+	}
+
+	void Server::SetLimits(size_t MaxAssociations,size_t MaxAssociationsPerAE,size_t MaxQueuedMessages)
+	{
+		{
+			boost::mutex::scoped_lock scoped_lock(mutex_);
+			MaxQueuedMessages_=MaxQueuedMessages;
+		}
+		boost::mutex::scoped_lock scoped_lock(AssociationsMutex_);
+		MaxAssociations_=MaxAssociations;
+		MaxAssociationsPerAE_=MaxAssociationsPerAE;
+	}
+
+	bool Server::AdmitAssociation(const std::string& CallingAET)
+	{
+		boost::mutex::scoped_lock scoped_lock(AssociationsMutex_);
+		size_t& FromAE=OpenAssociationsByAE_[CallingAET];
+		if((MaxAssociations_ && OpenAssociations_>=MaxAssociations_) ||
+			(MaxAssociationsPerAE_ && FromAE>=MaxAssociationsPerAE_))
+		{
+			if(0==FromAE)
+				OpenAssociationsByAE_.erase(CallingAET);
+			return false;
+		}
+		++OpenAssociations_;
+		++FromAE;
+		return true;
+	}
+
+	void Server::ReleaseAssociation(const std::string& CallingAET)
+	{
+		boost::mutex::scoped_lock scoped_lock(AssociationsMutex_);
+		std::map<std::string,size_t>::iterator I=OpenAssociationsByAE_.find(CallingAET);
+		if(I==OpenAssociationsByAE_.end())
+			return;
+		--OpenAssociations_;
+		if(0==--I->second)
+			OpenAssociationsByAE_.erase(I);
+	}
+
+
 	//!This is kind of pointless as there is only one application context acceptable in the standard.
 	bool Server::IsAcceptableApplicationContext(const UID& uid)
 	{
@@ -177,6 +292,10 @@ namespace dicom
 		return CurrentLogger_->AssociationNegotiated(request);
 
 	}
+	void Server::AssociationAccepted(const primitive::AAssociateRQ& request,const primitive::AAssociateAC& acceptance)
+	{
+		CurrentLogger_->AssociationAccepted(request,acceptance);
+	}
 	void Server::AssociationTerminated()
 	{
 		CurrentLogger_->AssociationTerminated();
@@ -281,11 +400,15 @@ namespace dicom
 
 
 	/*!
-		Waits for a connection to be made, checking every few seconds
-		for KillFlagRaised.
+		Waits for a connection to be made, or for the kill flag to be raised.
 	*/
 	bool Server::ClientConnectionPending(Network::Socket* pSocket)
 	{
+#ifndef _WIN32
+		if(pSocket->WaitForData(KillFlagDescriptor()))
+			return true;
+#else
+		//there's no pipe to wait on, so check every few seconds for KillFlagRaised.
 		for(;;)
 		{
 			fd_set rfds;//need to reset all this stuff after each call to select.
@@ -311,6 +434,7 @@ namespace dicom
 			if (retval)
 				return true;
 		}
+#endif
 		LogMessage ("Kill flag raised, accepting no more connections.");
 		return false;
 	}
@@ -347,8 +471,22 @@ namespace dicom
 	void Server::RaiseKillFlag()
 	{
 		boost::mutex::scoped_lock lock(killflag_mutex);
+		if(KillFlag)
+			return;
 		KillFlag=true;
+#ifndef _WIN32
+		BYTE wake=0;
+		if(write(KillPipe_[1],&wake,1)!=1)
+			LogError("Couldn't signal the kill flag.");
+#endif
+	}
+
+#ifndef _WIN32
+	int Server::KillFlagDescriptor() const
+	{
+		return KillPipe_[0];
 	}
+#endif
 
 
 	void Server::LogError(std::string Error)
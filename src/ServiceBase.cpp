@@ -22,7 +22,64 @@ namespace dicom
 {
 	using namespace primitive;
 
+	namespace
+	{
+		//!Sends length bytes of data as a P-DATA-TF holding a single PDV.
+		/*!
+			See Part 8, table 9-22 and 9-23.  The 12 bytes of PDU and PDV
+			headers, which are always big endian, go out in the same writev()
+			as the data.
+		*/
+		void SendPDataTF(Network::Socket& socket,BYTE PresentationContextID,
+			MessageControlHeader::Code msgHead,const BYTE* data,size_t length)
+		{
+			UINT32 PDULength=UINT32(length+6),PDVLength=UINT32(length+2);
+			BYTE header[12]=
+			{
+				0x04,0x00,
+				BYTE(PDULength>>24),BYTE(PDULength>>16),BYTE(PDULength>>8),BYTE(PDULength),
+				BYTE(PDVLength>>24),BYTE(PDVLength>>16),BYTE(PDVLength>>8),BYTE(PDVLength),
+				PresentationContextID,msgHead
+			};
+			socket.Sendv(header,sizeof(header),data,length);
+		}
+
+		//!Sends each block it's given as a P-DATA-TF holding a single PDV.
+		/*!
+			See Part 8, table 9-22 and 9-23.  EncoderOutput only tells us which
+			block is the last once it's got it, which is when we set the last
+			fragment bit.
+		*/
+		class PDataSink : public EncoderSink
+		{
+			Network::Socket& socket_;
+			BYTE PresentationContextID_;
+			MessageControlHeader::Code msgHead_;
+		public:
+			PDataSink(Network::Socket& socket,BYTE PresentationContextID,MessageControlHeader::Code msgHead)
+				:socket_(socket),PresentationContextID_(PresentationContextID),msgHead_(msgHead){}
+
+			void Write(const BYTE* data,size_t length,bool last)
+			{
+				MessageControlHeader::Code msgHead=msgHead_;
+				if(last)
+					msgHead|=MessageControlHeader::LAST_FRAGMENT;
+
+				SendPDataTF(socket_,PresentationContextID_,msgHead,data,length);
+			}
+		};
+
+		//!We'll happily send smaller PDUs than the peer will take, rather than hold huge blocks in memory.
+		/*!
+			What we've offered to take ourselves has no bearing on this, that
+			only limits what the peer sends us.
+		*/
+		const size_t MaxPDataBlockSize=1024*1024;
+	}//namespace
+
 	ServiceBase::ServiceBase()
+		:MaxPDULength_(DefaultMaxPDULength)
+		,PeerMaxPDULength_(DefaultMaxPDULength)
 	{}
 
 	//ServiceBase::ServiceBase(Network::Socket* socket):socket_(socket)
@@ -52,13 +109,17 @@ namespace dicom
 		//if (!GetPresentationContextID(AbstractSyntaxUID, tsUID))
 		//	throw exception("No presentation context ID");//bad transfer syntax, or something?
 
-		int ByteOrder=ts.isBigEndian()?__BIG_ENDIAN:__LITTLE_ENDIAN;
-		Buffer buffer(ByteOrder);
-
-		dicom::WriteToBuffer(ds,buffer,ts);
+		/*
+			Each block is sent as soon as it's been encoded, so we only ever hold
+			one PDU's worth of the data set, rather than all of it.
+		*/
+		UINT32 MaxPDULength=PeerMaxPDULength_;
+		size_t BlockSize=MaxPDataBlockSize;
+		if(MaxPDULength>6 && MaxPDULength-6<BlockSize)
+			BlockSize=MaxPDULength-6;
 
-		UINT32 MaxPDULength=AAssociateRQ_.UserInfo_.MaxSubLength_.MaximumLength_;
-		Write(buffer,msgHead,PresentationContextID,MaxPDULength);
+		PDataSink sink(*GetSocket(),PresentationContextID,msgHead);
+		dicom::WriteToSink(ds,sink,ts,BlockSize);
 	}
 
 	void ServiceBase::WriteCommand(const DataSet& ds,const UID& uid )
@@ -101,30 +162,15 @@ namespace dicom
 			See Part 8, table 9-22 and 9-23 to understand what we're sending here,
 			and realise that I've opted to only ever send ONE pdv with each P-DATA-TF.
 		*/
-			*socket << BYTE(0x04);
-			*socket << BYTE(0x00);
-			
 			UINT32 BytesLeftToSend=static_cast<UINT32>((buffer.end()-buffer.position()));
 			
 			const UINT32 BytesInThisChunk=std::min(BytesLeftToSend,MaxPDULength-6);
 
-
-			*socket << UINT32(BytesInThisChunk+6);
-			//now the PDV item
-			//We should use the PDV class to mediate this!
-
-			*socket << UINT32(BytesInThisChunk+2);
-			*socket << PresentationContextID;
-
-
 			if(buffer.position()+(BytesInThisChunk)==buffer.end())
 				msgHead |=MessageControlHeader::LAST_FRAGMENT;
 
-			*socket	<< msgHead;
-
-			//then send data...
 			BYTE* Begin=&(*(buffer.position()));
-			socket->Sendn(Begin,(BytesInThisChunk));
+			SendPDataTF(*socket,PresentationContextID,msgHead,Begin,BytesInThisChunk);
 
 			//buffer.position()+=(BytesInThisChunk);//this is now a bug...
 			buffer.Increment(BytesInThisChunk);
@@ -134,6 +180,9 @@ namespace dicom
 	/*!
 		returns false on association termination, else true.
 
+		Anything on Received_ has already been decoded, as ts would have
+		decoded it, so it's handed back as it is.
+
 
 		(We really shouldn't _handle_ the termination here, functions should do
 		one and only one thing.
@@ -143,6 +192,13 @@ namespace dicom
 	*/
 	bool ServiceBase::Read(DataSet& ds,TS ts)
 	{
+		if(!Received_.empty())
+		{
+			ds.swap(Received_.front());
+			Received_.pop_front();
+			return true;
+		}
+
 		int ByteOrder=ts.isBigEndian()?__BIG_ENDIAN:__LITTLE_ENDIAN;
 
 		PDataTF p_data_tf(ByteOrder);
@@ -152,10 +208,13 @@ namespace dicom
 		//Specified at Part 8/figure 9-2
 		/*
 			What we basically do here is pull data off of the TCP/IP stream onto
-			a PDataTF object(which has a BUFFER), and then at the end read
-			from the buffer onto the DataSet.  I'm not entirely happy about this
-			design, but there doesn't seem to be any other feasible approach.
+			a PDataTF object, which hands each fragment to the decoder as soon as
+			it arrives.  So we're parsing one fragment while the next is still on
+			its way, and never hold more than a fragment plus one element.
 		*/
+		IncrementalDecoder decoder(ds,ts);
+		p_data_tf.decoder_=&decoder;
+		p_data_tf.MaxLength_=MaxPDULength_;
 
 		Network::Socket* socket=GetSocket();
 		while(true)//loop, apparently implying that we can expect more than one PDATATF object.
@@ -171,7 +230,7 @@ namespace dicom
 
 					if (p_data_tf.MsgStatus > 0)//what is the corresponding 'else' ?
 					{
-						ParseRawVRIntoDataSet(p_data_tf,ds,ts);
+						decoder.Finish();
 						return true;
 					}
 					else
@@ -209,32 +268,6 @@ namespace dicom
 	}
 
 
-	void ServiceBase::ParseRawVRIntoDataSet(PDataTF& p_data_tf,DataSet& ds,TS ts)
-	{
-		//UID uid("");
-		//UID uid=GetTransferSyntaxUID(p_data_tf.PresentationContextID);
-
-		///*if(!GetTransferSyntaxUID(p_data_tf.PresentationContextID,uid))
-		//	throw std::runtime_error("Couldn't get Transfer Syntax UID");*/
-
-		//TS ts(uid);
-
-		/*
-			the buffer's internal pointer is somehow getting corrupted, so we reset it.
-			(maybe the internal memory is getting re-allocated, so begin() is somewhere
-			else than when it was first constructed?
-		*/
-
-		//p_data_tf.buffer_.reset();
-
-		if(p_data_tf.buffer_.position()!=p_data_tf.buffer_.begin())
-		{
-			throw exception("buffer.position()!=buffer.begin(), in ServiceBase::ParseRawVRIntoDataSet()");
-		}
-
-		ReadFromBuffer(p_data_tf.buffer_,ds,ts);
-	}
-
 	/*
 		I'm still not sure about the following two functions.
 	*/
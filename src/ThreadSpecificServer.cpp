@@ -33,6 +33,7 @@ namespace dicom
 		:server_(s)
 		,socket_(socket)
 		,AssociationNegotiated_(false)
+		,Admitted_(false)
 // 		,association_identifier_(0)
 		{
 		}
@@ -51,11 +52,27 @@ namespace dicom
 		{
 
 			//Now we start up a message loop to handle incoming requests.
+#ifndef _WIN32
+			//sleeps until there's a message, or the kill flag is raised.
+			while(socket_->WaitForData(server_.KillFlagDescriptor()))//do we need to inform the client if we're shutting down?
+				if(!HandleNextMessage())
+					break;
+#else
+			while(!server_.KillFlagRaised())//do we need to inform the client if we're shutting down?
+				if(socket_->MoreData(1) && !HandleNextMessage())
+					break;
+#endif
+			/*unfortunate to have this here, but the only way I can think of that
+			closes sockets aggresively enough*/
+			Close();
+		}//thread will be destroyed after function exits.
+
+		bool ThreadSpecificServer::HandleNextMessage()
+		{
 			try
 			{
-				while(!server_.KillFlagRaised())//do we need to inform the client if we're shutting down?
-					if(socket_->MoreData(1))
-						HandleData();
+				HandleData();
+				return true;
 			}
 			catch(TerminateServerThread)//this is expected
 			{
@@ -66,10 +83,76 @@ namespace dicom
 				server_.LogError(e.what());
 				server_.LogError("This connection will close.");
 			}
-			/*unfortunate to have this here, but the only way I can think of that
-			closes sockets aggresively enough*/
+			return false;
+		}
+
+		/*!
+			The assembler is made here rather than in the constructor, as it
+			keeps a reference to this object, and in thread per connection
+			mode we get copied onto the new thread.
+		*/
+		bool ThreadSpecificServer::ReadAvailable()
+		{
+			if(!assembler_)
+				assembler_.reset(new MessageAssembler(*this));
+			return assembler_->ReadAvailable(AssociationNegotiated_);
+		}
+
+		bool ThreadSpecificServer::PartRead() const
+		{
+			return assembler_ && assembler_->PartRead();
+		}
+
+		void ThreadSpecificServer::Close()
+		{
+			if(Admitted_)
+				server_.ReleaseAssociation(AAssociateRQ_.CallingAppTitle_);
+			Admitted_=false;
 			delete socket_;
-		}//thread will be destroyed after function exits.
+			socket_=0;
+		}
+
+		namespace
+		{
+			//!Most of an A-ASSOCIATE-RQ that RejectAsBusy() will read before giving up on the rest.
+			const size_t MaxBusyRead=64*1024;
+		}
+
+		/*!
+			This is called on a Reactor I/O thread, which mustn't wait on a slow
+			peer, so the A-ASSOCIATE-RQ isn't read properly.  We just take
+			whatever of it has arrived, up to MaxBusyRead bytes, so that the
+			socket isn't closed with unread data - that resets the connection,
+			and the rejection can be lost on the way.  The calling AE title is
+			picked out of it for the log, if it's there.
+		*/
+		void ThreadSpecificServer::RejectAsBusy()
+		{
+			try
+			{
+				char buffer[4096];
+				std::string CallingAET("unknown AE");
+				size_t total=0;
+				for(int BytesRead;total<MaxBusyRead && (BytesRead=socket_->ReadAvailable(buffer,sizeof(buffer)))>0;total+=BytesRead)
+				{
+					//PDU type, reserved, length, protocol version, reserved, called AE title, then calling.
+					if(0==total && BytesRead>=42 && AAssociateRQ::ItemType_==BYTE(buffer[0]))
+					{
+						CallingAET.assign(buffer+26,16);
+						StripTrailingWhitespace(CallingAET);
+					}
+				}
+				AAssociateRJ Rejection (AAssociateRJ::REJECTED_TRANSIENT,
+					AAssociateRJ::DICOM_SERVICE_PROVIDER_PRESENTATION,
+					AAssociateRJ::TEMPORARY_CONGESTION);
+				server_.LogMessage("Too busy, rejected association from "+CallingAET);
+				Rejection.Write (*socket_);
+			}
+			catch(std::exception& e)
+			{
+				server_.LogError(e.what());
+			}
+		}
 
 		void ThreadSpecificServer::HandleData()
 		{
@@ -245,6 +328,16 @@ namespace dicom
 				Rejection.Write ( *socket_);
 				return ( false );
 			}
+			if(!server_.AdmitAssociation(association_request.CallingAppTitle_))
+			{
+				AAssociateRJ Rejection (AAssociateRJ::REJECTED_TRANSIENT,
+					AAssociateRJ::DICOM_SERVICE_PROVIDER_PRESENTATION,
+					AAssociateRJ::LOCAL_LIMIT_EXCEEDED);
+				server_.LogMessage("Too many associations, rejected association from "+association_request.CallingAppTitle_);
+				Rejection.Write ( *socket_);
+				return ( false );
+			}
+			Admitted_=true;
 			//ok, we got this far, so we'll send back an acceptance message.
 			AAssociateAC Acceptance;
 			// Transfer the information over to the A-ASSOCIATE-AC Class
@@ -308,7 +401,9 @@ namespace dicom
 				Acceptance.Write (*socket_);
 				return ( false );
 			}
-			MaxSubLength.Set(16384);	// we can do all DICOM can handle
+			MaxPDULength_=server_.GetMaxPDULength();
+			PeerMaxPDULength_=association_request.UserInfo_.MaxSubLength_.MaximumLength_;
+			MaxSubLength.Set(MaxPDULength_);
 			server_.GetImplementationClass(UserInfo.ImpClass_);
 			server_.GetImplementationVersion(UserInfo.ImpVersion_);
 			UserInfo.SetMax(MaxSubLength);
@@ -317,6 +412,7 @@ namespace dicom
 
 
 			Acceptance.Write(*socket_);
+			server_.AssociationAccepted(association_request,Acceptance);
 
 
 			return ( true );	// yes, the communication should work out
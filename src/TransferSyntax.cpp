@@ -11,23 +11,34 @@
 #include "UID.hpp"
 #include "UIDs.hpp"
 #include "Exceptions.hpp"
+#include "Codec.hpp"
 #include <sstream>
 namespace dicom
 {
 
 
-	TS::TS(const UID& uid):uid_(uid)
+	namespace
 	{
-		//make sure uid represents a known transfer syntax.
-		dicom::Enforce(
-			IMPL_VR_LE_TRANSFER_SYNTAX == uid			||
-			EXPL_VR_LE_TRANSFER_SYNTAX == uid			||
-			DEFLATED_EXPL_VR_LE_TRANSFER_SYNTAX == uid	||
-			EXPL_VR_BE_TRANSFER_SYNTAX == uid			||
-			JPEG_BASELINE_TRANSFER_SYNTAX == uid		||
-			JPEG_LOSSLESS_NON_HIERARCHICAL == uid
-			,"Syntax not recognised.");
+		//!The transfer syntaxes that aren't encapsulated.
+		bool IsNativeSyntax(const UID& uid)
+		{
+			return
+				IMPL_VR_LE_TRANSFER_SYNTAX == uid			||
+				EXPL_VR_LE_TRANSFER_SYNTAX == uid			||
+				DEFLATED_EXPL_VR_LE_TRANSFER_SYNTAX == uid	||
+				EXPL_VR_BE_TRANSFER_SYNTAX == uid;
+		}
+	}
 
+	/*!
+		Encapsulated transfer syntaxes are whichever have been registered with
+		RegisterCodec(), see Codec.hpp.  TSs are made all the time, so the
+		native ones are recognised without looking in the registry.
+	*/
+	TS::TS(const UID& uid):uid_(uid),encoded_(!IsNativeSyntax(uid) && IsRegisteredCodec(uid))
+	{
+		//make sure uid represents a known transfer syntax.
+		dicom::Enforce(encoded_ || IsNativeSyntax(uid),"Syntax not recognised.");
 	}
 
 	UID TS::getUID() const
@@ -61,9 +72,6 @@ namespace dicom
 	*/
 	bool TS::isEncoded() const
 	{
-		return (
-			JPEG_BASELINE_TRANSFER_SYNTAX==uid_||
-			JPEG_LOSSLESS_NON_HIERARCHICAL==uid_
-			);
+		return encoded_;
 	}
 }//namespace dicom
@@ -48,7 +48,7 @@ namespace dicom
 		std::for_each(data_.begin(),data_.end(),ThrowIfInvalid);
 
 	}
-	std::string UID::str()const
+	const std::string& UID::str()const
 	{
 		return data_;
 	}
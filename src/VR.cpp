@@ -0,0 +1,34 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <boost/preprocessor/repetition/repeat.hpp>
+#include "VR.hpp"
+
+namespace dicom
+{
+	constexpr VRTraits VRTable::Entries_[];
+
+	/*
+		Index_ is worked out by the compiler, one row of 26 slots for each
+		possible first letter.  Everything in it is a constant expression, so
+		it's filled in before any code runs and there's no initialisation order
+		to worry about.
+	*/
+#define DICOMLIB_VR_SLOT(z,column,row) VRTable::Find(row*26+column),
+#define DICOMLIB_VR_ROW(z,row,unused) BOOST_PP_REPEAT_ ## z(26,DICOMLIB_VR_SLOT,row)
+
+	const UINT8 VRTable::Index_[VRTable::Slots_]=
+	{
+		BOOST_PP_REPEAT(26,DICOMLIB_VR_ROW,~)
+		0
+	};
+
+#undef DICOMLIB_VR_ROW
+#undef DICOMLIB_VR_SLOT
+
+	BOOST_STATIC_ASSERT(sizeof(VRTable::Index_)==VRTable::Slots_);
+}//namespace dicom
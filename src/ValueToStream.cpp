@@ -47,6 +47,10 @@ namespace dicom
 				(*this) [VR_LO]=PAIR("Longstring","LO");
 				(*this) [VR_LT]=PAIR("Long Text","LT");
 				(*this) [VR_OB]=PAIR("OtherByteString","OB");
+				(*this) [VR_OD]=PAIR("OtherDoubleString","OD");
+				(*this) [VR_OF]=PAIR("OtherFloatString","OF");
+				(*this) [VR_OL]=PAIR("OtherLongString","OL");
+				(*this) [VR_OV]=PAIR("OtherVeryLongString","OV");
 				(*this) [VR_OW]=PAIR("OtherWordString","OW");
 				(*this) [VR_PN]=PAIR("PersonName","PN");
 				(*this) [VR_SH]=PAIR("ShortString","SH");
@@ -54,11 +58,16 @@ namespace dicom
 				(*this) [VR_SQ]=PAIR("Sequence","SQ");
 				(*this) [VR_SS]=PAIR("SignedShort","SS");
 				(*this) [VR_ST]=PAIR("Shorttext","ST");
+				(*this) [VR_SV]=PAIR("SignedVeryLong","SV");
 				(*this) [VR_TM]=PAIR("Time","TM");
+				(*this) [VR_UC]=PAIR("UnlimitedCharacters","UC");
 				(*this) [VR_UI]=PAIR("UniqueIdentifier","UI");
 				(*this) [VR_UL]=PAIR("UnsignedLong","UL");
 				(*this) [VR_UN]=PAIR("Unknown","UN");
+				(*this) [VR_UR]=PAIR("UniversalResourceIdentifier","UR");
 				(*this) [VR_US]=PAIR("UnsignedShort","US");
+				(*this) [VR_UT]=PAIR("UnlimitedText","UT");
+				(*this) [VR_UV]=PAIR("UnsignedVeryLong","UV");
 			}
 		};
 
@@ -120,6 +129,40 @@ namespace dicom
 				out << *I << ",";
 			out <<  "...(" <<  data.size() << " 2 byte pairs)" ;
 		}
+		//!OF, OD, OL and OV
+		template<VR vr>
+		void DumpVector(const Value& value,std::ostream& out)
+		{
+			typedef typename TypeFromVR<vr>::Type Type;
+			const Type& data = value.Get<Type>();
+
+			out << "binary data:";
+			for(typename Type::const_iterator I = data.begin();I!=data.end() and I<data.begin()+10;I++)
+				out << *I << ",";
+			out <<  "...(" <<  data.size() << " values)" ;
+		}
+
+		template<>
+		void Dump2<VR_OD>(const Value& value,std::ostream& out)
+		{
+			DumpVector<VR_OD>(value,out);
+		}
+		template<>
+		void Dump2<VR_OF>(const Value& value,std::ostream& out)
+		{
+			DumpVector<VR_OF>(value,out);
+		}
+		template<>
+		void Dump2<VR_OL>(const Value& value,std::ostream& out)
+		{
+			DumpVector<VR_OL>(value,out);
+		}
+		template<>
+		void Dump2<VR_OV>(const Value& value,std::ostream& out)
+		{
+			DumpVector<VR_OV>(value,out);
+		}
+
 		template<>
 		void Dump2<VR_UN>(const Value& value,std::ostream& out)
 		{
@@ -210,6 +253,14 @@ namespace dicom
 				return Dump2<VR_LT>(value,out);
 			case VR_OB:
 				return Dump2<VR_OB>(value,out);
+			case VR_OD:
+				return Dump2<VR_OD>(value,out);
+			case VR_OF:
+				return Dump2<VR_OF>(value,out);
+			case VR_OL:
+				return Dump2<VR_OL>(value,out);
+			case VR_OV:
+				return Dump2<VR_OV>(value,out);
 			case VR_OW:
 				return Dump2<VR_OW>(value,out);
 			case VR_PN:
@@ -224,18 +275,26 @@ namespace dicom
 				return Dump2<VR_SS> (value,out);
 			case VR_ST:
 				return Dump2<VR_ST>(value,out);
+			case VR_SV:
+				return Dump2<VR_SV>(value,out);
 			case VR_TM:
 				return Dump2<VR_TM>(value,out);
+			case VR_UC:
+				return Dump2<VR_UC>(value,out);
 			case VR_UI:
 				return Dump2<VR_UI>(value,out);
 			case VR_UL:
 				return Dump2<VR_UL>(value,out);
 			case VR_UN:
 				return Dump2<VR_UN>(value,out);
+			case VR_UR:
+				return Dump2<VR_UR>(value,out);
 			case VR_US:
 				return Dump2<VR_US> (value,out);
 			case VR_UT:
 				return Dump2<VR_UT>(value,out);
+			case VR_UV:
+				return Dump2<VR_UV>(value,out);
 			default:
 				throw BadVR(value.vr());
 
@@ -305,16 +364,24 @@ namespace dicom
 				return ValueFromStream<VR_SS> (In);
 			case VR_ST:
 				return ValueFromStream<VR_ST>(In);
+			case VR_SV:
+				return ValueFromStream<VR_SV>(In);
 			case VR_TM:
 				return ValueFromStream<VR_TM>(In);
+			case VR_UC:
+				return ValueFromStream<VR_UC>(In);
 			case VR_UI:
 				return ValueFromStream<VR_UI>(In);
 			case VR_UL:
 				return ValueFromStream<VR_UL>(In);
+			case VR_UR:
+				return ValueFromStream<VR_UR>(In);
 			case VR_US:
 				return ValueFromStream<VR_US> (In);
 			case VR_UT:
 				return ValueFromStream<VR_UT>(In);
+			case VR_UV:
+				return ValueFromStream<VR_UV>(In);
 			default:
 				throw BadVR(vr);
 			}
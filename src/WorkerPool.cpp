@@ -0,0 +1,92 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <boost/bind/bind.hpp>
+#include "WorkerPool.hpp"
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	namespace Implementation
+	{
+		WorkerPool::WorkerPool(size_t threads,size_t MaxQueued)
+			:MaxQueued_(MaxQueued)
+			,stopping_(false)
+		{
+			if(0==threads)
+				throw dicom::exception("WorkerPool needs at least one thread.");
+			for(size_t i=0;i<threads;i++)
+				threads_.create_thread(boost::bind(&WorkerPool::Run,this));
+		}
+
+		WorkerPool::~WorkerPool()
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				stopping_=true;
+			}
+			ready_.notify_all();
+			room_.notify_all();
+			threads_.join_all();
+		}
+
+		void WorkerPool::Post(Job job)
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				while(MaxQueued_ && jobs_.size()>=MaxQueued_ && !stopping_)
+					room_.wait(lock);
+				jobs_.push_back(job);
+			}
+			ready_.notify_one();
+		}
+
+		void WorkerPool::PostNow(Job job)
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				jobs_.push_back(job);
+			}
+			ready_.notify_one();
+		}
+
+		bool WorkerPool::Saturated()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			return MaxQueued_ && jobs_.size()>=MaxQueued_;
+		}
+
+		/*!
+			Jobs are expected to handle their own errors, anything that gets out
+			is dropped so that it can't take the thread with it.
+		*/
+		void WorkerPool::Run()
+		{
+			for(;;)
+			{
+				Job job;
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					while(jobs_.empty() && !stopping_)
+						ready_.wait(lock);
+					if(jobs_.empty())
+						return;
+					job.swap(jobs_.front());
+					jobs_.pop_front();
+				}
+				room_.notify_one();
+				try
+				{
+					job();
+				}
+				catch(...)
+				{
+				}
+			}
+		}
+	}//namespace Implementation
+}//namespace dicom
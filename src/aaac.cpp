@@ -140,6 +140,7 @@ namespace dicom
 
 		void AAssociateAC::Write(Network::Socket	&socket)
 		{
+			Network::Corked corked(socket);
 			
 			socket << ItemType_;
 			socket << Reserved1_;
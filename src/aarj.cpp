@@ -74,6 +74,7 @@ namespace dicom
 
 		void AAssociateRJ::Write(Network::Socket& socket)
 		{
+			Network::Corked corked(socket);
 			socket << ItemType_;
 			socket << Reserved1_;
 			socket << Length_;
@@ -112,6 +113,7 @@ namespace dicom
 
 		void AReleaseRQ::Write(Network::Socket& socket)
 		{
+			Network::Corked corked(socket);
 			socket << ItemType_;
 			socket << Reserved1_;
 			socket << Length_;
@@ -146,6 +148,7 @@ namespace dicom
 
 		void AReleaseRP::Write(Network::Socket& socket)
 		{
+			Network::Corked corked(socket);
 
 			socket << ItemType_;
 			socket << Reserved1_;
@@ -197,6 +200,7 @@ namespace dicom
 
 		void AAbortRQ::Write(Network::Socket& socket)
 		{
+			Network::Corked corked(socket);
 			socket << ItemType_;
 			socket << Reserved1_;
 			socket << Length_;
@@ -405,6 +405,7 @@ namespace dicom
 		************************************************************************/
 
 		MaximumSubLength::MaximumSubLength()
+			:MaximumLength_(0)
 		{
 		}
 
@@ -699,6 +700,7 @@ We should maybe branch to try this out
 
 		void AAssociateRQ::Write(Network::Socket& socket)
 		{
+			Network::Corked corked(socket);
 			Size();
 			socket << ItemType_;
 			socket << Reserved1_;
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <assert.h>
 #include "Decoder.hpp"
+#include "aarj.hpp"
+#include "Exceptions.hpp"
 #include "iso646.h"
 //#include "Profiling.hpp"
 
@@ -37,8 +39,26 @@ namespace dicom
 		//UINT32 ReadDynamic(Network::Socket& socket);
 	};
 
+	namespace
+	{
+		//!Most of a PDV we read in one go, so what we hold doesn't depend on how long the peer says it is.
+		const UINT32 MaxPDVChunk=64*1024;
+
+		//!Sends an A-ABORT, and throws.
+		void AbortMalformed(Network::Socket& socket,const std::string& problem)
+		{
+			primitive::AAbortRQ abort_request(primitive::AAbortRQ::DICOM_SERVICE_PROVIDER,
+				primitive::AAbortRQ::INVALID_PDU_PARAMETER);
+			abort_request.Write(socket);
+			throw dicom::exception(problem);
+		}
+	}
+
 	/*!
 		documented in Part 8, section 7.6,  figure  9-2 and tables 9-22 and 9-23
+
+		Each PDV is read MaxPDVChunk bytes at a time, and handed to the
+		decoder as it comes, so memory only grows as data actually arrives.
 	*/
 
  	bool	PDataTF::ReadDynamic(Network::Socket& socket)
@@ -52,6 +72,8 @@ namespace dicom
  			socket >> Reserved_dummy;//shouldn't this fail?
  			socket >> Length;
  		}
+		if(MaxLength_ && Length>MaxLength_)
+			AbortMalformed(socket,"P-DATA-TF is longer than the Maximum PDU Length we offered.");
 
  		Count = Length;
  		MsgStatus = 0;	// continue
@@ -60,41 +82,27 @@ namespace dicom
  		{
 
  			//I think that this should happen in a member of PDV-.
+			if(Count<sizeof(UINT32)+2)
+				AbortMalformed(socket,"P-DATA-TF ends part way through a PDV header.");
  			socket >> pdv.Length;
+			if(pdv.Length<2 || pdv.Length>Count-sizeof(UINT32))
+				AbortMalformed(socket,"PDV length doesn't fit its P-DATA-TF.");
  			socket >> pdv.PresentationContextID;
  			socket >> pdv.MessageHeader;
 
-
 			//now read actual data from socket onto buffer.
-			//std::vector<BYTE> data(pdv.Length-2);
-			//socket >> data;
-			//std::copy(data.begin(),data.end(),std::back_inserter(buffer_));
-			buffer_.insert(buffer_.end(),pdv.Length-2,0x00);
-			socket.Readn(&*(buffer_.end()-(pdv.Length-2)),(pdv.Length-2));//slightly more complicated.
-
-
-			/*
-				The previous 3 lines could be dramatically speeded up if
-				we _first_ allocate the space on buffer, then pass _pointers_
-				to the begin and end of the new space to Socket::Readn();
-
-				I'm not going to change this till I have a good unit test for the change
-
-				Meyers says in 'Efficient STL' that member functions are preferable
-				over algorithms for efficiency?
-
-				So possible optimizations would be:
-				1)
-
-				buffer_.insert(buffer_.end(),data.begin(),data.end());//this is simple.
-
-				2)
-
-				buffer_.insert(buffer_.end(),pdv.Length-2,0x00);
-				socket.Readn(buffer_.end()-(pdv.Length-2),(pdv.Length-2));//slightly more complicated.
-
-				We need profiling tests for both, such as dicomtest::SubmitLotsOfImages()
-			*/
+			for(UINT32 left=pdv.Length-2;left;)
+			{
+				UINT32 n=std::min(left,MaxPDVChunk);
+				buffer_.insert(buffer_.end(),n,0x00);
+				socket.Readn(&*(buffer_.end()-n),n);
+				left-=n;
+				if(decoder_)
+				{
+					decoder_->Feed(&buffer_[0],&buffer_[0]+buffer_.size());
+					buffer_.clear();
+				}
+			}
 
  			Count = Count - pdv.Length - sizeof(UINT32);
  			Length = Length - pdv.Length - sizeof(UINT32);
@@ -122,6 +130,8 @@ namespace dicom
 	PDataTF::PDataTF(int ByteOrder)
 	:buffer_(ByteOrder)
 	,Length(0)
+	,decoder_(0)
+	,MaxLength_(0)
 
 	{
 	}